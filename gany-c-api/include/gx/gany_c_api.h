@@ -37,16 +37,55 @@ typedef int64_t CAnyFuncPtr;
 
 typedef const char *GAnyString;
 
+/// Result of the non-logging ganyTry* functions.
+typedef enum GAnyStatus
+{
+    GANY_STATUS_OK = 0,
+    GANY_STATUS_NOT_FOUND,      ///< No such item or method, nothing was logged
+    GANY_STATUS_ERROR,          ///< An exception was raised, see ganyLastError
+} GAnyStatus;
+
+/// Element type of a C buffer exchanged with a GAny array.
+typedef enum GAnyBufferType
+{
+    GANY_BUFFER_INT8 = 0,
+    GANY_BUFFER_INT16,
+    GANY_BUFFER_INT32,
+    GANY_BUFFER_INT64,
+    GANY_BUFFER_FLOAT,
+    GANY_BUFFER_DOUBLE,
+    GANY_BUFFER_BOOL,
+    GANY_BUFFER_POINTER,
+} GAnyBufferType;
+
 typedef GAnyPtr(GX_API_PTR *CAnyFunctionProxy)(CAnyFuncPtr funcPtr, GAnyPtr *args, int32_t argc);
 
+/**
+ * Proxy that receives borrowed handles: args and retSlot point at values owned by the caller and are only
+ * valid on the calling thread until the proxy returns, they must not be destroyed. Using one after that is
+ * reported as an invalid handle. Write the result with ganyAssign*(retSlot, ...),
+ * it is null if left untouched. Use ganyCreate(arg) to keep an argument beyond the call.
+ */
+typedef void(GX_API_PTR *CAnyFunctionBorrowedProxy)(CAnyFuncPtr funcPtr, const GAnyPtr *args, int32_t argc, GAnyPtr retSlot);
+
 typedef void(GX_API_PTR *CAnyFunctionDtorListener)(CAnyFuncPtr funcPtr);
 
+/**
+ * Free a string returned by ganyToString, ganyToJsonString or ganyDump. O(1), no global lock.
+ * Only strings returned by these functions may be passed, and each exactly once; anything else is undefined behaviour.
+ */
 GX_API void GX_API_CALL ganyFreeString(GAnyString str);
 
 GX_API void GX_API_CALL ganySetFunctionProxy(CAnyFunctionProxy proxy);
 
 GX_API void GX_API_CALL ganySetFunctionDtorListener(CAnyFunctionDtorListener listener);
 
+/**
+ * When set, functions created by ganyCreateFunction call this proxy instead of the CAnyFunctionProxy,
+ * without allocating handles for the arguments or the result.
+ */
+GX_API void GX_API_CALL ganySetFunctionBorrowedProxy(CAnyFunctionBorrowedProxy proxy);
+
 /// ================= GAny =================
 
 GX_API GAnyPtr GX_API_CALL ganyCreate(GAnyPtr v);
@@ -79,8 +118,48 @@ GX_API GAnyPtr GX_API_CALL ganyCreateUndefined();
 
 GX_API GAnyPtr GX_API_CALL ganyCreateNull();
 
+/**
+ * Release a handle. Handles are checked, so releasing a stale handle twice is reported instead of crashing.
+ */
 GX_API void GX_API_CALL ganyDestroy(GAnyPtr any);
 
+/**
+ * Release every handle the given scope still owns, without closing it. The scope must be open on the
+ * calling thread; 0 is this thread's default scope, handles other threads created there are left alone.
+ * @return Number of handles released
+ */
+GX_API int32_t GX_API_CALL ganyReleaseAll(int32_t scope);
+
+/**
+ * Open a handle scope on the calling thread. Handles created on this thread are owned by the
+ * innermost scope until it is popped.
+ * @return Scope id, usable with ganyReleaseAll
+ */
+GX_API int32_t GX_API_CALL ganyPushScope();
+
+/**
+ * Close the innermost scope and release every handle still owned by it.
+ * @return Number of handles released
+ */
+GX_API int32_t GX_API_CALL ganyPopScope();
+
+/**
+ * Hand a handle over to the enclosing scope (or the default scope) so it survives ganyPopScope.
+ * @return The same handle
+ */
+GX_API GAnyPtr GX_API_CALL ganyEscape(GAnyPtr any);
+
+/// Replace the value held by dst (a handle or a borrowed return slot, borrowed arguments are read-only).
+GX_API void GX_API_CALL ganyAssign(GAnyPtr dst, GAnyPtr src);
+
+GX_API void GX_API_CALL ganyAssignBool(GAnyPtr dst, bool v);
+
+GX_API void GX_API_CALL ganyAssignInt64(GAnyPtr dst, int64_t v);
+
+GX_API void GX_API_CALL ganyAssignDouble(GAnyPtr dst, double v);
+
+GX_API void GX_API_CALL ganyAssignString(GAnyPtr dst, const char *v);
+
 GX_API GAnyPtr GX_API_CALL ganyImport(const char *path);
 
 GX_API void GX_API_CALL ganyExport(GAnyPtr clazz);
@@ -154,6 +233,15 @@ GX_API GAnyString GX_API_CALL ganyToString(GAnyPtr any);
 
 GX_API GAnyString GX_API_CALL ganyToJsonString(GAnyPtr any, int32_t indent);
 
+/**
+ * Write the string form of any into a caller-provided buffer, truncating and always NUL-terminating
+ * (nothing is written when bufferSize is 0).
+ * @return Length of the full string in bytes, excluding the terminator. When it is >= bufferSize the buffer was
+ *         too small: it holds the first bufferSize - 1 bytes, and a buffer of the returned length + 1 fits the whole
+ *         string. An invalid handle is logged and yields an empty string, returning 0.
+ */
+GX_API size_t GX_API_CALL ganyToStringBuf(GAnyPtr any, char *buffer, size_t bufferSize);
+
 GX_API GAnyPtr GX_API_CALL ganyToObject(GAnyPtr any);
 
 GX_API GAnyPtr GX_API_CALL ganyParseJson(const char *json);
@@ -181,13 +269,92 @@ GX_API GAnyPtr GX_API_CALL ganyCallMethod(GAnyPtr any, const char *methodName, G
 
 GX_API GAnyPtr GX_API_CALL ganyCallFunction(GAnyPtr any, GAnyPtr args[], int32_t argc);
 
+/**
+ * Resolve a method by name once. classOrInstance may be a class or any value of that class.
+ * @return Method handle for ganyInvokeMethod (release with ganyDestroy), or 0 if there is no such method
+ */
+GX_API GAnyPtr GX_API_CALL ganyLookupMethod(GAnyPtr classOrInstance, const char *methodName);
+
+/**
+ * Invoke a method resolved by ganyLookupMethod. self is ignored for static functions.
+ */
+GX_API GAnyPtr GX_API_CALL ganyInvokeMethod(GAnyPtr method, GAnyPtr self, GAnyPtr args[], int32_t argc);
+
 
 GX_API GAnyPtr GX_API_CALL ganyGetItem(GAnyPtr any, GAnyPtr i);
 
+/**
+ * Look up an item without logging or unwinding on a miss. *out receives a new handle on GANY_STATUS_OK, 0 otherwise.
+ */
+GX_API GAnyStatus GX_API_CALL ganyTryGetItem(GAnyPtr any, GAnyPtr i, GAnyPtr *out);
+
+/**
+ * Call a method if it exists, without logging. *out receives a new handle on GANY_STATUS_OK, 0 otherwise.
+ */
+GX_API GAnyStatus GX_API_CALL ganyTryCallMethod(GAnyPtr any, const char *methodName, GAnyPtr args[], int32_t argc,
+                                                GAnyPtr *out);
+
+/**
+ * Message of the last GANY_STATUS_ERROR on the calling thread, valid until the next error on that thread.
+ */
+GX_API const char *GX_API_CALL ganyLastError();
+
 GX_API void GX_API_CALL ganySetItem(GAnyPtr any, GAnyPtr i, GAnyPtr v);
 
 GX_API void GX_API_CALL ganyDelItem(GAnyPtr any, GAnyPtr i);
 
+/// ================= Batch =================
+
+/**
+ * out[i] = any[keys[i]] for n keys in one call; failed lookups yield undefined.
+ * @return Number of successful lookups
+ */
+GX_API int32_t GX_API_CALL ganyGetItems(GAnyPtr any, const GAnyPtr keys[], int32_t n, GAnyPtr out[]);
+
+/**
+ * any[keys[i]] = values[i] for n pairs in one call.
+ * @return Number of items set
+ */
+GX_API int32_t GX_API_CALL ganySetItems(GAnyPtr any, const GAnyPtr keys[], const GAnyPtr values[], int32_t n);
+
+/**
+ * Convert up to n leading elements of an array into out.
+ * @return Number of elements written
+ */
+GX_API int32_t GX_API_CALL ganyToInt64Array(GAnyPtr array, int64_t *out, size_t n);
+
+GX_API int32_t GX_API_CALL ganyToDoubleArray(GAnyPtr array, double *out, size_t n);
+
+/**
+ * Build an array from a C buffer in one call.
+ */
+GX_API GAnyPtr GX_API_CALL ganyCreateArrayFromInt32s(const int32_t *values, size_t n);
+
+GX_API GAnyPtr GX_API_CALL ganyCreateArrayFromInt64s(const int64_t *values, size_t n);
+
+GX_API GAnyPtr GX_API_CALL ganyCreateArrayFromFloats(const float *values, size_t n);
+
+GX_API GAnyPtr GX_API_CALL ganyCreateArrayFromDoubles(const double *values, size_t n);
+
+/// Null entries become null values.
+GX_API GAnyPtr GX_API_CALL ganyCreateArrayFromStrings(const char *const *values, size_t n);
+
+GX_API GAnyPtr GX_API_CALL ganyCreateArrayFromPointers(void *const *values, size_t n);
+
+/**
+ * Convert up to n leading elements of an array into a C buffer of the given element type.
+ * Non-pointer elements are written as nullptr for GANY_BUFFER_POINTER.
+ * @return Number of elements written
+ */
+GX_API int32_t GX_API_CALL ganyCopyToBuffer(GAnyPtr array, GAnyBufferType type, void *out, size_t n);
+
+/**
+ * out[i] = receivers[i].methodName(args...) for n receivers, sharing one argument list.
+ * @return Number of successful calls; failed calls yield undefined
+ */
+GX_API int32_t GX_API_CALL ganyCallMethodBatch(const GAnyPtr receivers[], int32_t n, const char *methodName,
+                                               const GAnyPtr args[], int32_t argc, GAnyPtr out[]);
+
 
 GX_API GAnyPtr GX_API_CALL ganyOperatorNeg(GAnyPtr any);     // -any
 
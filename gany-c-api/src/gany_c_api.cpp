@@ -26,33 +26,492 @@
 #include <gx/gmutex.h>
 
 #include <memory.h>
+#include <atomic>
 
 
 using namespace gx;
 
-static CAnyFunctionProxy sCAnyFunctionProxy = nullptr;
-static CAnyFunctionDtorListener sCAnyFunctionDtorListener = nullptr;
-
-static GRWLock sLockFuncProxy;
-static GRWLock sLockFDtor;
+// Read on every proxied call, so plain atomics instead of read-write locks.
+static std::atomic<CAnyFunctionProxy> sCAnyFunctionProxy{nullptr};
+static std::atomic<CAnyFunctionBorrowedProxy> sCAnyFunctionBorrowedProxy{nullptr};
+static std::atomic<CAnyFunctionDtorListener> sCAnyFunctionDtorListener{nullptr};
 
 const static std::string EmptyStr;
-static std::vector<std::unique_ptr<std::string>> sStringCache;
-static GMutex sStrCacheLock;
 
 static GAny sLogger;
 
+/// Message of the last GANY_STATUS_ERROR returned on this thread, see ganyLastError.
+static thread_local std::string sLastError;
+
+
+/// ================= Handle table =================
+
+/**
+ * GAnyPtr handles are (generation << 32 | index + 1) pairs into a chunked table of GAny slots.
+ * Chunks are never moved or freed, so a lookup takes no lock, and the generation (odd while
+ * the slot is live) lets stale or double-released handles be detected instead of corrupting memory.
+ * Released slots go to a per-thread free list first, so steady-state creation does not allocate.
+ */
+class GAnyHandleTable
+{
+public:
+    static constexpr uint32_t ChunkBits = 10;
+    static constexpr uint32_t ChunkSize = 1u << ChunkBits;
+    static constexpr uint32_t MaxChunks = 1u << 14;
+    static constexpr uint32_t MaxCached = 512;
+    static constexpr uint32_t Batch = 128;
+    static constexpr uint32_t GenMask = 0x7fffffff;
+
+    static GAnyHandleTable &instance()
+    {
+        // Never destroyed: handles may still be released from thread exit or static destructors.
+        static auto *sTable = new GAnyHandleTable();
+        return *sTable;
+    }
+
+    GAnyPtr create(const GAny &v, uint32_t scope)
+    {
+        const uint32_t index = acquireIndex();
+        Slot *s = slot(index);
+        new(s->storage) GAny(v);
+        s->scope.store(scope, std::memory_order_relaxed);
+        const uint32_t gen = s->generation.load(std::memory_order_relaxed) + 1;
+        s->generation.store(gen, std::memory_order_release);
+        return makeHandle(index, gen);
+    }
+
+    GAny *get(GAnyPtr handle)
+    {
+        uint32_t index, gen;
+        Slot *s = find(handle, index, gen);
+        return s ? s->value() : nullptr;
+    }
+
+    bool release(GAnyPtr handle)
+    {
+        uint32_t index, gen;
+        Slot *s = find(handle, index, gen);
+        if (!s) {
+            return false;
+        }
+        uint32_t cur = s->generation.load(std::memory_order_acquire);
+        return (cur & GenMask) == gen && releaseSlot(index, cur);
+    }
+
+    /**
+     * Release handle only if it still belongs to scope (it was not escaped meanwhile).
+     */
+    bool releaseInScope(GAnyPtr handle, uint32_t scope)
+    {
+        uint32_t index, gen;
+        Slot *s = find(handle, index, gen);
+        if (!s || s->scope.load(std::memory_order_relaxed) != scope) {
+            return false;
+        }
+        uint32_t cur = s->generation.load(std::memory_order_acquire);
+        return (cur & GenMask) == gen && releaseSlot(index, cur);
+    }
+
+    bool moveToScope(GAnyPtr handle, uint32_t scope)
+    {
+        uint32_t index, gen;
+        Slot *s = find(handle, index, gen);
+        if (!s) {
+            return false;
+        }
+        s->scope.store(scope, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * Whether handle is live and still belongs to scope.
+     */
+    bool isInScope(GAnyPtr handle, uint32_t scope)
+    {
+        uint32_t index, gen;
+        Slot *s = find(handle, index, gen);
+        return s && s->scope.load(std::memory_order_relaxed) == scope;
+    }
+
+private:
+    struct Slot
+    {
+        alignas(GAny) unsigned char storage[sizeof(GAny)];
+        std::atomic<uint32_t> generation{0};
+        std::atomic<uint32_t> scope{0};
+
+        GAny *value()
+        {
+            return reinterpret_cast<GAny *>(storage);
+        }
+    };
+
+    struct ThreadCache
+    {
+        std::vector<uint32_t> free;
+
+        ~ThreadCache()
+        {
+            GAnyHandleTable::instance().returnIndices(free, free.size());
+        }
+    };
+
+    static GAnyPtr makeHandle(uint32_t index, uint32_t gen)
+    {
+        return (GAnyPtr) (((uint64_t) (gen & GenMask) << 32) | ((uint64_t) index + 1));
+    }
+
+    Slot *slot(uint32_t index)
+    {
+        return mChunks[index >> ChunkBits].load(std::memory_order_acquire) + (index & (ChunkSize - 1));
+    }
+
+    Slot *find(GAnyPtr handle, uint32_t &index, uint32_t &gen)
+    {
+        const auto raw = (uint64_t) handle;
+        if ((raw & 0xffffffff) == 0) {
+            return nullptr;
+        }
+        index = (uint32_t) (raw & 0xffffffff) - 1;
+        gen = (uint32_t) (raw >> 32);
+        if (gen > GenMask || index >= mNextIndex.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        Slot *s = slot(index);
+        const uint32_t cur = s->generation.load(std::memory_order_acquire);
+        if ((cur & 1) == 0 || (cur & GenMask) != gen) {
+            return nullptr;
+        }
+        return s;
+    }
+
+    bool releaseSlot(uint32_t index, uint32_t gen)
+    {
+        Slot *s = slot(index);
+        if (!s->generation.compare_exchange_strong(gen, gen + 1, std::memory_order_acq_rel)) {
+            return false;
+        }
+        s->value()->~GAny();
+
+        auto &cache = threadCache();
+        cache.free.push_back(index);
+        if (cache.free.size() > MaxCached) {
+            returnIndices(cache.free, Batch);
+        }
+        return true;
+    }
+
+    uint32_t acquireIndex()
+    {
+        auto &cache = threadCache();
+        if (cache.free.empty()) {
+            refill(cache.free);
+        }
+        const uint32_t index = cache.free.back();
+        cache.free.pop_back();
+        return index;
+    }
+
+    void refill(std::vector<uint32_t> &out)
+    {
+        GLockerGuard locker(mLock);
+        if (!mFree.empty()) {
+            const size_t n = std::min<size_t>(Batch, mFree.size());
+            out.insert(out.end(), mFree.end() - (ptrdiff_t) n, mFree.end());
+            mFree.resize(mFree.size() - n);
+            return;
+        }
+        const uint32_t begin = mNextIndex.load(std::memory_order_relaxed);
+        const uint32_t chunk = begin >> ChunkBits;
+        if (chunk >= MaxChunks) {
+            throw std::bad_alloc();
+        }
+        if (!mChunks[chunk].load(std::memory_order_relaxed)) {
+            mChunks[chunk].store(new Slot[ChunkSize], std::memory_order_release);
+        }
+        // Hand out the rest of the current chunk, lowest index last so it is used first.
+        const uint32_t end = (chunk + 1) << ChunkBits;
+        for (uint32_t i = end; i > begin; i--) {
+            out.push_back(i - 1);
+        }
+        mNextIndex.store(end, std::memory_order_release);
+    }
+
+    void returnIndices(std::vector<uint32_t> &from, size_t n)
+    {
+        if (n == 0) {
+            return;
+        }
+        GLockerGuard locker(mLock);
+        mFree.insert(mFree.end(), from.begin(), from.begin() + (ptrdiff_t) n);
+        from.erase(from.begin(), from.begin() + (ptrdiff_t) n);
+    }
+
+    static ThreadCache &threadCache()
+    {
+        static thread_local ThreadCache sCache;
+        return sCache;
+    }
+
+private:
+    std::atomic<Slot *> mChunks[MaxChunks] = {};
+    std::atomic<uint32_t> mNextIndex{0};
+    GMutex mLock;
+    std::vector<uint32_t> mFree;
+};
+
+/**
+ * Per-thread stack of handle scopes. Each frame remembers the handles created in it, so popping
+ * releases exactly those instead of scanning the table. Frames are kept after a pop to reuse their storage.
+ * The root frame holds the handles this thread created in the default scope.
+ */
+struct GAnyScopeStack
+{
+    static constexpr size_t MinCompact = 1024;
+
+    struct Frame
+    {
+        uint32_t id = 0;
+        std::vector<GAnyPtr> handles;
+        size_t compactAt = MinCompact;
+    };
+
+    Frame root;
+    std::vector<Frame> frames;
+    size_t depth = 0;
+
+    Frame *top()
+    {
+        return depth > 0 ? &frames[depth - 1] : nullptr;
+    }
+
+    Frame &current()
+    {
+        return depth > 0 ? frames[depth - 1] : root;
+    }
+
+    Frame *findFrame(uint32_t id)
+    {
+        if (id == 0) {
+            return &root;
+        }
+        for (size_t i = 0; i < depth; i++) {
+            if (frames[i].id == id) {
+                return &frames[i];
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * Record handle in frame. Handles destroyed one by one stay listed until the list doubles,
+     * then the dead ones are dropped, so a frame never grows past twice its live handles.
+     */
+    static void track(Frame &frame, GAnyPtr handle)
+    {
+        frame.handles.push_back(handle);
+        if (frame.handles.size() < frame.compactAt) {
+            return;
+        }
+        auto &table = GAnyHandleTable::instance();
+        auto &handles = frame.handles;
+        handles.erase(std::remove_if(handles.begin(), handles.end(), [&](GAnyPtr h) {
+            return !table.isInScope(h, frame.id);
+        }), handles.end());
+        frame.compactAt = std::max(MinCompact, handles.size() * 2);
+    }
+
+    /**
+     * Release the listed handles that still belong to scope id. Takes the id rather than the frame,
+     * since destructors may push scopes and move the frames.
+     * @return Number of handles released
+     */
+    static int32_t release(uint32_t id, const std::vector<GAnyPtr> &handles)
+    {
+        auto &table = GAnyHandleTable::instance();
+        int32_t released = 0;
+        for (GAnyPtr handle: handles) {
+            if (table.releaseInScope(handle, id)) {
+                released++;
+            }
+        }
+        return released;
+    }
+};
+
+static std::atomic<uint32_t> sNextScopeId{1};
+static thread_local GAnyScopeStack sScopeStack;
+static thread_local uint32_t sCurrentScope = 0;
+
 static GAnyPtr ganyCreatePtr(const GAny &v)
 {
-    return reinterpret_cast<GAnyPtr>(GX_NEW(GAny, v));
+    GAnyPtr handle = GAnyHandleTable::instance().create(v, sCurrentScope);
+    GAnyScopeStack::track(sScopeStack.current(), handle);
+    return handle;
 }
 
-static GAnyString cacheString(std::string &&str)
+/**
+ * Borrowed handles name a GAny owned by the caller of a proxied call, registered on the calling thread for
+ * the duration of that call. They carry the sign bit, a per-call serial and an index into the registry,
+ * so a handle that outlives its call, or any other value with the sign bit set, is rejected.
+ * Arguments are read-only, only the return slot may be assigned.
+ */
+class GAnyBorrowedRegistry
 {
-    GLockerGuard locker(sStrCacheLock);
+    struct Slot
+    {
+        const GAny *any;
+        GAny *writable;
+        uint32_t serial;
+    };
 
-    sStringCache.push_back(std::make_unique<std::string>(std::move(str)));
-    return sStringCache.back()->c_str();
+public:
+    static constexpr uint64_t HandleBit = 1ull << 63;
+
+    class CallScope
+    {
+    public:
+        explicit CallScope(GAnyBorrowedRegistry &registry)
+                : mRegistry(registry), mBase(registry.mSlots.size()), mSerial(registry.nextSerial())
+        {
+        }
+
+        ~CallScope()
+        {
+            mRegistry.mSlots.resize(mBase);
+        }
+
+        GAnyPtr borrow(const GAny *any)
+        {
+            return push({any, nullptr, mSerial});
+        }
+
+        GAnyPtr borrowReturn(GAny *ret)
+        {
+            return push({ret, ret, mSerial});
+        }
+
+    private:
+        GAnyPtr push(const Slot &slot)
+        {
+            auto &slots = mRegistry.mSlots;
+            slots.push_back(slot);
+            return (GAnyPtr) (HandleBit | ((uint64_t) mSerial << 32) | (uint64_t) slots.size());
+        }
+
+        GAnyBorrowedRegistry &mRegistry;
+        size_t mBase;
+        uint32_t mSerial;
+    };
+
+    static GAnyBorrowedRegistry &current()
+    {
+        static thread_local GAnyBorrowedRegistry sRegistry;
+        return sRegistry;
+    }
+
+    static bool isBorrowed(GAnyPtr handle)
+    {
+        return (uint64_t) handle & HandleBit;
+    }
+
+    const GAny *get(GAnyPtr handle) const
+    {
+        const Slot *slot = find(handle);
+        return slot ? slot->any : nullptr;
+    }
+
+    /**
+     * The borrowed value if handle may be assigned, i.e. it is the return slot of the current call.
+     */
+    GAny *getWritable(GAnyPtr handle) const
+    {
+        const Slot *slot = find(handle);
+        return slot ? slot->writable : nullptr;
+    }
+
+private:
+    const Slot *find(GAnyPtr handle) const
+    {
+        const auto raw = (uint64_t) handle;
+        const auto index = (size_t) (raw & 0xffffffff);
+        const auto serial = (uint32_t) ((raw & ~HandleBit) >> 32);
+        if (index == 0 || index > mSlots.size() || mSlots[index - 1].serial != serial) {
+            return nullptr;
+        }
+        return &mSlots[index - 1];
+    }
+
+    uint32_t nextSerial()
+    {
+        mSerial = (mSerial + 1) & 0x7fffffff;
+        return mSerial;
+    }
+
+private:
+    std::vector<Slot> mSlots;
+    uint32_t mSerial = 0;
+};
+
+static GAny *ganyGet(GAnyPtr handle)
+{
+    GAny *any = GAnyBorrowedRegistry::isBorrowed(handle)
+                ? const_cast<GAny *>(GAnyBorrowedRegistry::current().get(handle))
+                : GAnyHandleTable::instance().get(handle);
+    if (!any) {
+        throw GAnyException("Invalid GAny handle (null, stale or already destroyed).");
+    }
+    return any;
+}
+
+/**
+ * Resolve the destination of a ganyAssign*: a table handle or the return slot of the current proxied call.
+ */
+static GAny *ganyGetAssignable(GAnyPtr handle)
+{
+    if (!GAnyBorrowedRegistry::isBorrowed(handle)) {
+        return ganyGet(handle);
+    }
+    auto &registry = GAnyBorrowedRegistry::current();
+    GAny *any = registry.getWritable(handle);
+    if (!any) {
+        throw GAnyException(registry.get(handle)
+                            ? "Borrowed arguments are read-only, only the return slot can be assigned."
+                            : "Invalid GAny handle (null, stale or already destroyed).");
+    }
+    return any;
+}
+
+/**
+ * Returned strings are single heap blocks: a header followed by the NUL-terminated text.
+ * ganyFreeString finds the header from the text pointer, so freeing is O(1) and takes no lock.
+ */
+struct GAnyStringHeader
+{
+    uint64_t size;
+};
+
+static GAnyString cacheString(const std::string &str)
+{
+    auto *header = static_cast<GAnyStringHeader *>(malloc(sizeof(GAnyStringHeader) + str.size() + 1));
+    if (!header) {
+        return EmptyStr.c_str();
+    }
+    header->size = str.size();
+    char *text = reinterpret_cast<char *>(header + 1);
+    memcpy(text, str.data(), str.size());
+    text[str.size()] = '\0';
+    return text;
+}
+
+static size_t copyString(const std::string &str, char *buffer, size_t bufferSize)
+{
+    if (buffer && bufferSize > 0) {
+        const size_t n = std::min(str.size(), bufferSize - 1);
+        memcpy(buffer, str.data(), n);
+        buffer[n] = '\0';
+    }
+    return str.size();
 }
 
 static void printLogE(const std::string &log)
@@ -87,9 +546,9 @@ public:
 
     ~CAnyFunctionDtorHandler()
     {
-        auto locker = sLockFDtor.readGuard();
-        if (sCAnyFunctionDtorListener) {
-            sCAnyFunctionDtorListener(mFuncPtr);
+        auto listener = sCAnyFunctionDtorListener.load(std::memory_order_acquire);
+        if (listener) {
+            listener(mFuncPtr);
         }
     }
 
@@ -99,37 +558,36 @@ private:
 
 void ganyFreeString(GAnyString str)
 {
-    if (str == EmptyStr.c_str()) {
+    if (!str || str == EmptyStr.c_str()) {
         return;
     }
-    GLockerGuard locker(sStrCacheLock);
-    auto it = std::find_if(sStringCache.begin(), sStringCache.end(), [&](const auto &s) {
-        return str == s->c_str();
-    });
-    if (it != sStringCache.end()) {
-        if (sStringCache.size() > 1) {
-            std::swap(*it, *(sStringCache.end() - 1));
-        }
-        sStringCache.pop_back();
-    }
+    free(reinterpret_cast<GAnyStringHeader *>(const_cast<char *>(str)) - 1);
 }
 
 void ganySetFunctionProxy(CAnyFunctionProxy proxy)
 {
-    auto locker = sLockFuncProxy.writeGuard();
-    sCAnyFunctionProxy = proxy;
+    sCAnyFunctionProxy.store(proxy, std::memory_order_release);
 }
 
 void ganySetFunctionDtorListener(CAnyFunctionDtorListener listener)
 {
-    auto locker = sLockFDtor.writeGuard();
-    sCAnyFunctionDtorListener = listener;
+    sCAnyFunctionDtorListener.store(listener, std::memory_order_release);
+}
+
+void ganySetFunctionBorrowedProxy(CAnyFunctionBorrowedProxy proxy)
+{
+    sCAnyFunctionBorrowedProxy.store(proxy, std::memory_order_release);
 }
 
 
 GAnyPtr ganyCreate(GAnyPtr v)
 {
-    return ganyCreatePtr(*reinterpret_cast<const GAny *>(v));
+    try {
+        return ganyCreatePtr(*ganyGet(v));
+    } catch (const std::exception &e) {
+        printLogE(e.what());
+        return ganyCreatePtr(GAny::undefined());
+    }
 }
 
 GAnyPtr ganyCreateBool(bool v)
@@ -196,22 +654,33 @@ GAnyPtr ganyCreateFunction(CAnyFuncPtr funcPtr)
             [funcPtr, dtorHandler](const GAny **args, int32_t argc) {
                 try {
                     auto *tArgs = (GAnyPtr *) alloca(sizeof(GAnyPtr) * argc);
+
+                    auto borrowedProxy = sCAnyFunctionBorrowedProxy.load(std::memory_order_acquire);
+                    if (borrowedProxy) {
+                        static const GAny sNull = GAny::null();
+                        GAny ret = sNull;
+                        GAnyBorrowedRegistry::CallScope call(GAnyBorrowedRegistry::current());
+                        for (int32_t i = 0; i < argc; i++) {
+                            tArgs[i] = call.borrow(args[i]);
+                        }
+                        borrowedProxy(funcPtr, tArgs, argc, call.borrowReturn(&ret));
+                        return ret;
+                    }
+
                     for (int32_t i = 0; i < argc; i++) {
                         // Stored by the target language and released at the appropriate time.
                         tArgs[i] = ganyCreatePtr(*args[i]);
                     }
 
                     GAnyPtr ret = 0;
-                    {
-                        auto locker = sLockFuncProxy.readGuard();
-                        if (sCAnyFunctionProxy) {
-                            ret = sCAnyFunctionProxy(funcPtr, tArgs, argc);
-                        }
+                    auto proxy = sCAnyFunctionProxy.load(std::memory_order_acquire);
+                    if (proxy) {
+                        ret = proxy(funcPtr, tArgs, argc);
                     }
                     if (ret == 0) {
                         return GAny::null();
                     }
-                    GAny retCopy = *reinterpret_cast<GAny *>(ret);
+                    GAny retCopy = *ganyGet(ret);
                     ganyDestroy(ret);
 
                     return retCopy;
@@ -238,8 +707,137 @@ void ganyDestroy(GAnyPtr any)
     if (!any) {
         return;
     }
-    auto *anyPtr = reinterpret_cast<GAny *>(any);
-    GX_DELETE(anyPtr);
+    if (GAnyBorrowedRegistry::isBorrowed(any)) {
+        printLogE("ganyDestroy: borrowed handles are owned by the caller and must not be destroyed.");
+        return;
+    }
+    if (!GAnyHandleTable::instance().release(any)) {
+        printLogE("ganyDestroy: invalid GAny handle (stale or already destroyed).");
+    }
+}
+
+int32_t ganyReleaseAll(int32_t scope)
+{
+    auto *frame = sScopeStack.findFrame((uint32_t) scope);
+    if (!frame) {
+        printLogE("ganyReleaseAll: no such scope open on this thread.");
+        return 0;
+    }
+    // Swap the list out first, destructors may create handles in the same scope.
+    std::vector<GAnyPtr> handles;
+    handles.swap(frame->handles);
+    frame->compactAt = GAnyScopeStack::MinCompact;
+    const int32_t released = GAnyScopeStack::release((uint32_t) scope, handles);
+
+    frame = sScopeStack.findFrame((uint32_t) scope);
+    if (frame && frame->handles.empty()) {
+        handles.clear();
+        frame->handles.swap(handles);
+    }
+    return released;
+}
+
+int32_t ganyPushScope()
+{
+    auto &stack = sScopeStack;
+    if (stack.depth == stack.frames.size()) {
+        stack.frames.emplace_back();
+    }
+    auto &frame = stack.frames[stack.depth++];
+    frame.id = sNextScopeId.fetch_add(1, std::memory_order_relaxed);
+    frame.handles.clear();
+    frame.compactAt = GAnyScopeStack::MinCompact;
+    sCurrentScope = frame.id;
+    return (int32_t) frame.id;
+}
+
+int32_t ganyPopScope()
+{
+    auto &stack = sScopeStack;
+    auto *frame = stack.top();
+    if (!frame) {
+        printLogE("ganyPopScope: no scope to pop.");
+        return 0;
+    }
+    // Leave the scope first, so handles created by destructors go to the parent scope.
+    const uint32_t id = frame->id;
+    const size_t index = --stack.depth;
+    sCurrentScope = stack.top() ? stack.top()->id : 0;
+
+    std::vector<GAnyPtr> handles;
+    handles.swap(frame->handles);
+    frame->compactAt = GAnyScopeStack::MinCompact;
+    const int32_t released = GAnyScopeStack::release(id, handles);
+    // Destructors may have pushed scopes and grown the frame list, so look the frame up again.
+    handles.clear();
+    stack.frames[index].handles.swap(handles);
+    return released;
+}
+
+GAnyPtr ganyEscape(GAnyPtr any)
+{
+    auto &stack = sScopeStack;
+    auto *frame = stack.top();
+    if (!frame) {
+        return any;
+    }
+    auto &table = GAnyHandleTable::instance();
+    if (!table.isInScope(any, frame->id)) {
+        // Owned by an outer scope already (or escaped before), leave it where it is.
+        if (!table.get(any)) {
+            printLogE("ganyEscape: invalid GAny handle (stale or already destroyed).");
+        }
+        return any;
+    }
+    auto *parent = stack.depth > 1 ? &stack.frames[stack.depth - 2] : nullptr;
+    table.moveToScope(any, parent ? parent->id : 0);
+    GAnyScopeStack::track(parent ? *parent : stack.root, any);
+    return any;
+}
+
+void ganyAssign(GAnyPtr dst, GAnyPtr src)
+{
+    try {
+        *ganyGetAssignable(dst) = *ganyGet(src);
+    } catch (const std::exception &e) {
+        printLogE(e.what());
+    }
+}
+
+void ganyAssignBool(GAnyPtr dst, bool v)
+{
+    try {
+        *ganyGetAssignable(dst) = GAny(v);
+    } catch (const std::exception &e) {
+        printLogE(e.what());
+    }
+}
+
+void ganyAssignInt64(GAnyPtr dst, int64_t v)
+{
+    try {
+        *ganyGetAssignable(dst) = GAny(v);
+    } catch (const std::exception &e) {
+        printLogE(e.what());
+    }
+}
+
+void ganyAssignDouble(GAnyPtr dst, double v)
+{
+    try {
+        *ganyGetAssignable(dst) = GAny(v);
+    } catch (const std::exception &e) {
+        printLogE(e.what());
+    }
+}
+
+void ganyAssignString(GAnyPtr dst, const char *v)
+{
+    try {
+        *ganyGetAssignable(dst) = GAny(std::string(v));
+    } catch (const std::exception &e) {
+        printLogE(e.what());
+    }
 }
 
 GAnyPtr ganyImport(const char *path)
@@ -255,7 +853,7 @@ GAnyPtr ganyImport(const char *path)
 void ganyExport(GAnyPtr clazz)
 {
     try {
-        GAny::Export(*reinterpret_cast<GAny *>(clazz));
+        GAny::Export(*ganyGet(clazz));
     } catch (const std::exception &e) {
         printLogE(e.what());
     }
@@ -265,7 +863,7 @@ void ganyExport(GAnyPtr clazz)
 GAnyPtr ganyClone(GAnyPtr any)
 {
     try {
-        return ganyCreatePtr(reinterpret_cast<GAny *>(any)->clone());
+        return ganyCreatePtr(ganyGet(any)->clone());
     } catch (const std::exception &e) {
         printLogE(e.what());
         return ganyCreatePtr(GAny::undefined());
@@ -275,7 +873,7 @@ GAnyPtr ganyClone(GAnyPtr any)
 const char *ganyClassTypeName(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->classTypeName().c_str();
+        return ganyGet(any)->classTypeName().c_str();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return "";
@@ -285,7 +883,7 @@ const char *ganyClassTypeName(GAnyPtr any)
 const char *ganyTypeName(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->typeName().c_str();
+        return ganyGet(any)->typeName().c_str();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return "";
@@ -295,7 +893,7 @@ const char *ganyTypeName(GAnyPtr any)
 int32_t ganyLength(GAnyPtr any)
 {
     try {
-        return (int32_t) reinterpret_cast<GAny *>(any)->length();
+        return (int32_t) ganyGet(any)->length();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return 0;
@@ -305,7 +903,7 @@ int32_t ganyLength(GAnyPtr any)
 int32_t ganySize(GAnyPtr any)
 {
     try {
-        return (int32_t) reinterpret_cast<GAny *>(any)->size();
+        return (int32_t) ganyGet(any)->size();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return 0;
@@ -315,7 +913,7 @@ int32_t ganySize(GAnyPtr any)
 bool ganyIs(GAnyPtr any, const char *typeStr)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->is(typeStr);
+        return ganyGet(any)->is(typeStr);
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -325,7 +923,7 @@ bool ganyIs(GAnyPtr any, const char *typeStr)
 bool ganyIsUndefined(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->isUndefined();
+        return ganyGet(any)->isUndefined();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -335,7 +933,7 @@ bool ganyIsUndefined(GAnyPtr any)
 bool ganyIsNull(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->isNull();
+        return ganyGet(any)->isNull();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -345,7 +943,7 @@ bool ganyIsNull(GAnyPtr any)
 bool ganyIsFunction(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->isFunction();
+        return ganyGet(any)->isFunction();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -355,7 +953,7 @@ bool ganyIsFunction(GAnyPtr any)
 bool ganyIsClass(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->isClass();
+        return ganyGet(any)->isClass();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -365,7 +963,7 @@ bool ganyIsClass(GAnyPtr any)
 bool ganyIsException(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->isException();
+        return ganyGet(any)->isException();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -375,7 +973,7 @@ bool ganyIsException(GAnyPtr any)
 bool ganyIsProperty(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->isProperty();
+        return ganyGet(any)->isProperty();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -385,7 +983,7 @@ bool ganyIsProperty(GAnyPtr any)
 bool ganyIsEnum(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->isEnum();
+        return ganyGet(any)->isEnum();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -395,7 +993,7 @@ bool ganyIsEnum(GAnyPtr any)
 bool ganyIsObject(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->isObject();
+        return ganyGet(any)->isObject();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -405,7 +1003,7 @@ bool ganyIsObject(GAnyPtr any)
 bool ganyIsArray(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->isArray();
+        return ganyGet(any)->isArray();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -415,7 +1013,7 @@ bool ganyIsArray(GAnyPtr any)
 bool ganyIsInt32(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->isInt32();
+        return ganyGet(any)->isInt32();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -425,7 +1023,7 @@ bool ganyIsInt32(GAnyPtr any)
 bool ganyIsInt64(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->isInt64();
+        return ganyGet(any)->isInt64();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -435,7 +1033,7 @@ bool ganyIsInt64(GAnyPtr any)
 bool ganyIsInt8(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->isInt8();
+        return ganyGet(any)->isInt8();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -445,7 +1043,7 @@ bool ganyIsInt8(GAnyPtr any)
 bool ganyIsInt16(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->isInt16();
+        return ganyGet(any)->isInt16();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -455,7 +1053,7 @@ bool ganyIsInt16(GAnyPtr any)
 bool ganyIsFloat(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->isFloat();
+        return ganyGet(any)->isFloat();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -465,7 +1063,7 @@ bool ganyIsFloat(GAnyPtr any)
 bool ganyIsDouble(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->isDouble();
+        return ganyGet(any)->isDouble();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -475,7 +1073,7 @@ bool ganyIsDouble(GAnyPtr any)
 bool ganyIsNumber(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->isNumber();
+        return ganyGet(any)->isNumber();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -485,7 +1083,7 @@ bool ganyIsNumber(GAnyPtr any)
 bool ganyIsString(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->isString();
+        return ganyGet(any)->isString();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -495,7 +1093,7 @@ bool ganyIsString(GAnyPtr any)
 bool ganyIsBoolean(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->isBoolean();
+        return ganyGet(any)->isBoolean();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -505,7 +1103,7 @@ bool ganyIsBoolean(GAnyPtr any)
 bool ganyIsUserObject(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->isUserObject();
+        return ganyGet(any)->isUserObject();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -515,7 +1113,7 @@ bool ganyIsUserObject(GAnyPtr any)
 bool ganyIsPointer(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->is<GAnyBytePtr>();
+        return ganyGet(any)->is<GAnyBytePtr>();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -525,7 +1123,7 @@ bool ganyIsPointer(GAnyPtr any)
 int32_t ganyToInt32(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->toInt32();
+        return ganyGet(any)->toInt32();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return 0;
@@ -535,7 +1133,7 @@ int32_t ganyToInt32(GAnyPtr any)
 int64_t ganyToInt64(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->toInt64();
+        return ganyGet(any)->toInt64();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return 0;
@@ -545,7 +1143,7 @@ int64_t ganyToInt64(GAnyPtr any)
 int8_t ganyToInt8(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->toInt8();
+        return ganyGet(any)->toInt8();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return 0;
@@ -555,7 +1153,7 @@ int8_t ganyToInt8(GAnyPtr any)
 int16_t ganyToInt16(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->toInt16();
+        return ganyGet(any)->toInt16();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return 0;
@@ -565,7 +1163,7 @@ int16_t ganyToInt16(GAnyPtr any)
 float ganyToFloat(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->toFloat();
+        return ganyGet(any)->toFloat();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return 0;
@@ -575,7 +1173,7 @@ float ganyToFloat(GAnyPtr any)
 double ganyToDouble(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->toDouble();
+        return ganyGet(any)->toDouble();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return 0;
@@ -585,7 +1183,7 @@ double ganyToDouble(GAnyPtr any)
 bool ganyToBool(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->toBool();
+        return ganyGet(any)->toBool();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -595,8 +1193,7 @@ bool ganyToBool(GAnyPtr any)
 GAnyString ganyToString(GAnyPtr any)
 {
     try {
-        std::string str = reinterpret_cast<GAny *>(any)->toString();
-        return cacheString(std::move(str));
+        return cacheString(ganyGet(any)->toString());
     } catch (const std::exception &e) {
         printLogE(e.what());
         return EmptyStr.c_str();
@@ -606,18 +1203,31 @@ GAnyString ganyToString(GAnyPtr any)
 GAnyString ganyToJsonString(GAnyPtr any, int32_t indent)
 {
     try {
-        std::string str = reinterpret_cast<GAny *>(any)->toJsonString(indent);
-        return cacheString(std::move(str));
+        return cacheString(ganyGet(any)->toJsonString(indent));
     } catch (const std::exception &e) {
         printLogE(e.what());
         return EmptyStr.c_str();
     }
 }
 
+size_t ganyToStringBuf(GAnyPtr any, char *buffer, size_t bufferSize)
+{
+    try {
+        const GAny *anyPtr = ganyGet(any);
+        if (anyPtr->isString()) {
+            return copyString(anyPtr->as<std::string>(), buffer, bufferSize);
+        }
+        return copyString(anyPtr->toString(), buffer, bufferSize);
+    } catch (const std::exception &e) {
+        printLogE(e.what());
+        return copyString(EmptyStr, buffer, bufferSize);
+    }
+}
+
 GAnyPtr ganyToObject(GAnyPtr any)
 {
     try {
-        return ganyCreatePtr(reinterpret_cast<GAny *>(any)->toObject());
+        return ganyCreatePtr(ganyGet(any)->toObject());
     } catch (const std::exception &e) {
         printLogE(e.what());
         return ganyCreatePtr(GAny::undefined());
@@ -637,7 +1247,7 @@ GAnyPtr ganyParseJson(const char *json)
 void *ganyToPointer(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->castAs<GAnyBytePtr>();
+        return ganyGet(any)->castAs<GAnyBytePtr>();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return nullptr;
@@ -647,7 +1257,7 @@ void *ganyToPointer(GAnyPtr any)
 GAnyString ganyDump(GAnyPtr any)
 {
     try {
-        GAny *anyPtr = reinterpret_cast<GAny *>(any);
+        GAny *anyPtr = ganyGet(any);
         std::stringstream ss;
         if (anyPtr->is<GAnyClass>()) {
             ss << anyPtr->as<GAnyClass>();
@@ -656,8 +1266,7 @@ GAnyString ganyDump(GAnyPtr any)
         } else {
             ss << *anyPtr;
         }
-        std::string str = ss.str();
-        return cacheString(std::move(str));
+        return cacheString(ss.str());
     } catch (const std::exception &e) {
         printLogE(e.what());
         return EmptyStr.c_str();
@@ -667,8 +1276,8 @@ GAnyString ganyDump(GAnyPtr any)
 bool ganyContains(GAnyPtr any, GAnyPtr id)
 {
     try {
-        GAny idAny = *reinterpret_cast<GAny *>(id);
-        return reinterpret_cast<GAny *>(any)->contains(idAny);
+        GAny idAny = *ganyGet(id);
+        return ganyGet(any)->contains(idAny);
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -678,8 +1287,8 @@ bool ganyContains(GAnyPtr any, GAnyPtr id)
 void ganyErase(GAnyPtr any, GAnyPtr id)
 {
     try {
-        GAny idAny = *reinterpret_cast<GAny *>(id);
-        reinterpret_cast<GAny *>(any)->erase(idAny);
+        GAny idAny = *ganyGet(id);
+        ganyGet(any)->erase(idAny);
     } catch (const std::exception &e) {
         printLogE(e.what());
     }
@@ -688,8 +1297,8 @@ void ganyErase(GAnyPtr any, GAnyPtr id)
 void ganyPushBack(GAnyPtr any, GAnyPtr rh)
 {
     try {
-        GAny rhAny = *reinterpret_cast<GAny *>(rh);
-        reinterpret_cast<GAny *>(any)->pushBack(rhAny);
+        GAny rhAny = *ganyGet(rh);
+        ganyGet(any)->pushBack(rhAny);
     } catch (const std::exception &e) {
         printLogE(e.what());
     }
@@ -698,7 +1307,7 @@ void ganyPushBack(GAnyPtr any, GAnyPtr rh)
 void ganyClear(GAnyPtr any)
 {
     try {
-        reinterpret_cast<GAny *>(any)->clear();
+        ganyGet(any)->clear();
     } catch (const std::exception &e) {
         printLogE(e.what());
     }
@@ -707,7 +1316,7 @@ void ganyClear(GAnyPtr any)
 GAnyPtr ganyIterator(GAnyPtr any)
 {
     try {
-        return ganyCreatePtr(reinterpret_cast<GAny *>(any)->iterator());
+        return ganyCreatePtr(ganyGet(any)->iterator());
     } catch (const std::exception &e) {
         printLogE(e.what());
         return ganyCreatePtr(GAny::undefined());
@@ -717,7 +1326,7 @@ GAnyPtr ganyIterator(GAnyPtr any)
 bool ganyHasNext(GAnyPtr any)
 {
     try {
-        return reinterpret_cast<GAny *>(any)->hasNext();
+        return ganyGet(any)->hasNext();
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -727,7 +1336,7 @@ bool ganyHasNext(GAnyPtr any)
 GAnyPtr ganyNext(GAnyPtr any)
 {
     try {
-        return ganyCreatePtr(reinterpret_cast<GAny *>(any)->next());
+        return ganyCreatePtr(ganyGet(any)->next());
     } catch (const std::exception &e) {
         printLogE(e.what());
         return ganyCreatePtr(GAny::undefined());
@@ -738,11 +1347,11 @@ GAnyPtr ganyNext(GAnyPtr any)
 GAnyPtr ganyCallMethod(GAnyPtr any, const char *methodName, GAnyPtr *args, int32_t argc)
 {
     try {
-        std::vector<GAny> argv;
+        auto **argv = (const GAny **) alloca(sizeof(GAny *) * argc);
         for (int32_t i = 0; i < argc; i++) {
-            argv.push_back(*reinterpret_cast<GAny *>(args[i]));
+            argv[i] = ganyGet(args[i]);
         }
-        GAny ret = reinterpret_cast<GAny *>(any)->_call(methodName, argv);
+        GAny ret = ganyGet(any)->_call(methodName, argv, argc);
         return ganyCreatePtr(ret);
     } catch (const std::exception &e) {
         printLogE(e.what());
@@ -753,11 +1362,11 @@ GAnyPtr ganyCallMethod(GAnyPtr any, const char *methodName, GAnyPtr *args, int32
 GAnyPtr ganyCallFunction(GAnyPtr any, GAnyPtr *args, int32_t argc)
 {
     try {
-        std::vector<GAny> argv;
+        auto **argv = (const GAny **) alloca(sizeof(GAny *) * argc);
         for (int32_t i = 0; i < argc; i++) {
-            argv.push_back(*reinterpret_cast<GAny *>(args[i]));
+            argv[i] = ganyGet(args[i]);
         }
-        GAny ret = reinterpret_cast<GAny *>(any)->_call(argv);
+        GAny ret = ganyGet(any)->_call(argv, argc);
         return ganyCreatePtr(ret);
     } catch (const std::exception &e) {
         printLogE(e.what());
@@ -766,11 +1375,126 @@ GAnyPtr ganyCallFunction(GAnyPtr any, GAnyPtr *args, int32_t argc)
 }
 
 
+/**
+ * Method resolved once by ganyLookupMethod. withSelf tells whether the receiver is passed as the first argument.
+ */
+struct CAnyMethod
+{
+    GAny func;
+    bool withSelf;
+};
+
+static bool hasCastParents(const GAnyClass &clazz)
+{
+    for (const GAny &p: clazz.getParents()) {
+        if (!p.isClass() || hasCastParents(p.as<GAnyClass>())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+GAnyPtr ganyLookupMethod(GAnyPtr classOrInstance, const char *methodName)
+{
+    try {
+        const GAny *target = ganyGet(classOrInstance);
+        const GAnyClass &clazz = target->isClass() ? target->as<GAnyClass>() : target->classObject();
+        std::string name = methodName;
+
+        if (!hasCastParents(clazz)) {
+            GAny member = clazz.findMember(name);
+            if (member.isFunction()) {
+                const bool withSelf = member.as<GAnyFunction>().isMethod();
+                return ganyCreatePtr(GAny(CAnyMethod{std::move(member), withSelf}));
+            }
+            printLogE("ganyLookupMethod: class " + clazz.getName() + " has no method " + name + ".");
+            return 0;
+        }
+
+        // Parents reached through a cast need the receiver converted on every call, so keep dynamic dispatch.
+        GAny dispatch = GAnyFunction::createVariadicFunction(
+                name, "",
+                [name](const GAny **args, int32_t argc) {
+                    return args[0]->_call(name, args + 1, argc - 1);
+                });
+        return ganyCreatePtr(GAny(CAnyMethod{std::move(dispatch), true}));
+    } catch (const std::exception &e) {
+        printLogE(e.what());
+        return 0;
+    }
+}
+
+GAnyPtr ganyInvokeMethod(GAnyPtr method, GAnyPtr self, GAnyPtr *args, int32_t argc)
+{
+    try {
+        const GAny *methodPtr = ganyGet(method);
+        if (!methodPtr->is<CAnyMethod>()) {
+            throw GAnyException("ganyInvokeMethod: handle was not returned by ganyLookupMethod.");
+        }
+        const auto &m = methodPtr->as<CAnyMethod>();
+
+        const int32_t offset = m.withSelf ? 1 : 0;
+        auto **argv = (const GAny **) alloca(sizeof(GAny *) * (argc + offset));
+        if (m.withSelf) {
+            argv[0] = ganyGet(self);
+        }
+        for (int32_t i = 0; i < argc; i++) {
+            argv[i + offset] = ganyGet(args[i]);
+        }
+        return ganyCreatePtr(m.func.as<GAnyFunction>()._call(argv, argc + offset));
+    } catch (const std::exception &e) {
+        printLogE(e.what());
+        return ganyCreateUndefined();
+    }
+}
+
+
+GAnyStatus ganyTryGetItem(GAnyPtr any, GAnyPtr i, GAnyPtr *out)
+{
+    *out = 0;
+    try {
+        auto ret = ganyGet(any)->tryGetItem(*ganyGet(i));
+        if (!ret) {
+            return GANY_STATUS_NOT_FOUND;
+        }
+        *out = ganyCreatePtr(*ret);
+        return GANY_STATUS_OK;
+    } catch (const std::exception &e) {
+        sLastError = e.what();
+        return GANY_STATUS_ERROR;
+    }
+}
+
+GAnyStatus ganyTryCallMethod(GAnyPtr any, const char *methodName, GAnyPtr args[], int32_t argc, GAnyPtr *out)
+{
+    *out = 0;
+    try {
+        auto **argv = (const GAny **) alloca(sizeof(GAny *) * argc);
+        for (int32_t i = 0; i < argc; i++) {
+            argv[i] = ganyGet(args[i]);
+        }
+        auto ret = ganyGet(any)->tryCall(methodName, argv, argc);
+        if (!ret) {
+            return GANY_STATUS_NOT_FOUND;
+        }
+        *out = ganyCreatePtr(*ret);
+        return GANY_STATUS_OK;
+    } catch (const std::exception &e) {
+        sLastError = e.what();
+        return GANY_STATUS_ERROR;
+    }
+}
+
+const char *ganyLastError()
+{
+    return sLastError.c_str();
+}
+
 GAnyPtr ganyGetItem(GAnyPtr any, GAnyPtr i)
 {
     try {
-        GAny iAny = *reinterpret_cast<GAny *>(i);
-        GAny ret = reinterpret_cast<GAny *>(any)->getItem(iAny);
+        GAny iAny = *ganyGet(i);
+        GAny ret = ganyGet(any)->getItem(iAny);
         return ganyCreatePtr(ret);
     } catch (const std::exception &e) {
         printLogE(e.what());
@@ -781,9 +1505,9 @@ GAnyPtr ganyGetItem(GAnyPtr any, GAnyPtr i)
 void ganySetItem(GAnyPtr any, GAnyPtr i, GAnyPtr v)
 {
     try {
-        GAny iAny = *reinterpret_cast<GAny *>(i);
-        GAny vAny = *reinterpret_cast<GAny *>(v);
-        reinterpret_cast<GAny *>(any)->setItem(iAny, vAny);
+        GAny iAny = *ganyGet(i);
+        GAny vAny = *ganyGet(v);
+        ganyGet(any)->setItem(iAny, vAny);
     } catch (const std::exception &e) {
         printLogE(e.what());
     }
@@ -792,18 +1516,212 @@ void ganySetItem(GAnyPtr any, GAnyPtr i, GAnyPtr v)
 void ganyDelItem(GAnyPtr any, GAnyPtr i)
 {
     try {
-        GAny iAny = *reinterpret_cast<GAny *>(i);
-        reinterpret_cast<GAny *>(any)->delItem(iAny);
+        GAny iAny = *ganyGet(i);
+        ganyGet(any)->delItem(iAny);
+    } catch (const std::exception &e) {
+        printLogE(e.what());
+    }
+}
+
+
+int32_t ganyGetItems(GAnyPtr any, const GAnyPtr keys[], int32_t n, GAnyPtr out[])
+{
+    int32_t count = 0;
+    const GAny *anyPtr = nullptr;
+    try {
+        anyPtr = ganyGet(any);
+    } catch (const std::exception &e) {
+        printLogE(e.what());
+    }
+    for (int32_t i = 0; i < n; i++) {
+        try {
+            if (!anyPtr) {
+                out[i] = ganyCreateUndefined();
+                continue;
+            }
+            out[i] = ganyCreatePtr(anyPtr->getItem(*ganyGet(keys[i])));
+            count++;
+        } catch (const std::exception &e) {
+            printLogE(e.what());
+            out[i] = ganyCreateUndefined();
+        }
+    }
+    return count;
+}
+
+int32_t ganySetItems(GAnyPtr any, const GAnyPtr keys[], const GAnyPtr values[], int32_t n)
+{
+    int32_t count = 0;
+    try {
+        GAny *anyPtr = ganyGet(any);
+        for (int32_t i = 0; i < n; i++) {
+            try {
+                anyPtr->setItem(*ganyGet(keys[i]), *ganyGet(values[i]));
+                count++;
+            } catch (const std::exception &e) {
+                printLogE(e.what());
+            }
+        }
+    } catch (const std::exception &e) {
+        printLogE(e.what());
+    }
+    return count;
+}
+
+template<typename T, typename Convert>
+static int32_t copyArrayTo(GAnyPtr array, T *out, size_t n, Convert convert)
+{
+    try {
+        const GAny *anyPtr = ganyGet(array);
+        if (!anyPtr->isArray()) {
+            return 0;
+        }
+        const auto &arr = anyPtr->as<GAnyArray>();
+        const size_t count = std::min(n, arr.length());
+        for (size_t i = 0; i < count; i++) {
+            out[i] = convert(arr[(int32_t) i]);
+        }
+        return (int32_t) count;
+    } catch (const std::exception &e) {
+        printLogE(e.what());
+        return 0;
+    }
+}
+
+int32_t ganyToInt64Array(GAnyPtr array, int64_t *out, size_t n)
+{
+    return copyArrayTo(array, out, n, [](const GAny &v) {
+        return v.toInt64();
+    });
+}
+
+int32_t ganyToDoubleArray(GAnyPtr array, double *out, size_t n)
+{
+    return copyArrayTo(array, out, n, [](const GAny &v) {
+        return v.toDouble();
+    });
+}
+
+template<typename T, typename Box>
+static GAnyPtr createArrayFrom(const T *values, size_t n, Box box)
+{
+    try {
+        std::vector<GAny> vec;
+        vec.reserve(n);
+        for (size_t i = 0; i < n; i++) {
+            vec.push_back(box(values[i]));
+        }
+        return ganyCreatePtr(caster<std::vector<GAny>>::to(std::move(vec)));
+    } catch (const std::exception &e) {
+        printLogE(e.what());
+        return ganyCreatePtr(GAny::array());
+    }
+}
+
+GAnyPtr ganyCreateArrayFromInt32s(const int32_t *values, size_t n)
+{
+    return createArrayFrom(values, n, [](int32_t v) {
+        return GAny(v);
+    });
+}
+
+GAnyPtr ganyCreateArrayFromInt64s(const int64_t *values, size_t n)
+{
+    return createArrayFrom(values, n, [](int64_t v) {
+        return GAny(v);
+    });
+}
+
+GAnyPtr ganyCreateArrayFromFloats(const float *values, size_t n)
+{
+    return createArrayFrom(values, n, [](float v) {
+        return GAny(v);
+    });
+}
+
+GAnyPtr ganyCreateArrayFromDoubles(const double *values, size_t n)
+{
+    return createArrayFrom(values, n, [](double v) {
+        return GAny(v);
+    });
+}
+
+GAnyPtr ganyCreateArrayFromStrings(const char *const *values, size_t n)
+{
+    return createArrayFrom(values, n, [](const char *v) {
+        return v ? GAny(std::string(v)) : GAny::null();
+    });
+}
+
+GAnyPtr ganyCreateArrayFromPointers(void *const *values, size_t n)
+{
+    return createArrayFrom(values, n, [](void *v) {
+        return GAny((GAnyBytePtr) v);
+    });
+}
+
+int32_t ganyCopyToBuffer(GAnyPtr array, GAnyBufferType type, void *out, size_t n)
+{
+    switch (type) {
+        case GANY_BUFFER_INT8:
+            return copyArrayTo(array, (int8_t *) out, n, [](const GAny &v) { return v.toInt8(); });
+        case GANY_BUFFER_INT16:
+            return copyArrayTo(array, (int16_t *) out, n, [](const GAny &v) { return v.toInt16(); });
+        case GANY_BUFFER_INT32:
+            return copyArrayTo(array, (int32_t *) out, n, [](const GAny &v) { return v.toInt32(); });
+        case GANY_BUFFER_INT64:
+            return copyArrayTo(array, (int64_t *) out, n, [](const GAny &v) { return v.toInt64(); });
+        case GANY_BUFFER_FLOAT:
+            return copyArrayTo(array, (float *) out, n, [](const GAny &v) { return v.toFloat(); });
+        case GANY_BUFFER_DOUBLE:
+            return copyArrayTo(array, (double *) out, n, [](const GAny &v) { return v.toDouble(); });
+        case GANY_BUFFER_BOOL:
+            return copyArrayTo(array, (bool *) out, n, [](const GAny &v) { return v.toBool(); });
+        case GANY_BUFFER_POINTER:
+            return copyArrayTo(array, (void **) out, n, [](const GAny &v) -> void * {
+                return v.is<GAnyBytePtr>() ? v.as<GAnyBytePtr>() : nullptr;
+            });
+    }
+    printLogE("ganyCopyToBuffer: unknown buffer type.");
+    return 0;
+}
+
+int32_t ganyCallMethodBatch(const GAnyPtr receivers[], int32_t n, const char *methodName,
+                            const GAnyPtr args[], int32_t argc, GAnyPtr out[])
+{
+    int32_t count = 0;
+    const GAny **argv = nullptr;
+    std::string method;
+    try {
+        argv = (const GAny **) alloca(sizeof(GAny *) * argc);
+        for (int32_t i = 0; i < argc; i++) {
+            argv[i] = ganyGet(args[i]);
+        }
+        method = methodName;
     } catch (const std::exception &e) {
         printLogE(e.what());
+        for (int32_t i = 0; i < n; i++) {
+            out[i] = ganyCreateUndefined();
+        }
+        return 0;
+    }
+    for (int32_t i = 0; i < n; i++) {
+        try {
+            out[i] = ganyCreatePtr(ganyGet(receivers[i])->_call(method, argv, argc));
+            count++;
+        } catch (const std::exception &e) {
+            printLogE(e.what());
+            out[i] = ganyCreateUndefined();
+        }
     }
+    return count;
 }
 
 
 GAnyPtr ganyOperatorNeg(GAnyPtr any)
 {
     try {
-        return ganyCreatePtr(-(*reinterpret_cast<GAny *>(any)));
+        return ganyCreatePtr(-(*ganyGet(any)));
     } catch (const std::exception &e) {
         printLogE(e.what());
         return ganyCreateUndefined();
@@ -813,7 +1731,7 @@ GAnyPtr ganyOperatorNeg(GAnyPtr any)
 GAnyPtr ganyOperatorAdd(GAnyPtr a, GAnyPtr b)
 {
     try {
-        return ganyCreatePtr((*reinterpret_cast<GAny *>(a)) + (*reinterpret_cast<GAny *>(b)));
+        return ganyCreatePtr((*ganyGet(a)) + (*ganyGet(b)));
     } catch (const std::exception &e) {
         printLogE(e.what());
         return ganyCreateUndefined();
@@ -823,7 +1741,7 @@ GAnyPtr ganyOperatorAdd(GAnyPtr a, GAnyPtr b)
 GAnyPtr ganyOperatorSub(GAnyPtr a, GAnyPtr b)
 {
     try {
-        return ganyCreatePtr((*reinterpret_cast<GAny *>(a)) - (*reinterpret_cast<GAny *>(b)));
+        return ganyCreatePtr((*ganyGet(a)) - (*ganyGet(b)));
     } catch (const std::exception &e) {
         printLogE(e.what());
         return ganyCreateUndefined();
@@ -833,7 +1751,7 @@ GAnyPtr ganyOperatorSub(GAnyPtr a, GAnyPtr b)
 GAnyPtr ganyOperatorMul(GAnyPtr a, GAnyPtr b)
 {
     try {
-        return ganyCreatePtr((*reinterpret_cast<GAny *>(a)) * (*reinterpret_cast<GAny *>(b)));
+        return ganyCreatePtr((*ganyGet(a)) * (*ganyGet(b)));
     } catch (const std::exception &e) {
         printLogE(e.what());
         return ganyCreateUndefined();
@@ -843,7 +1761,7 @@ GAnyPtr ganyOperatorMul(GAnyPtr a, GAnyPtr b)
 GAnyPtr ganyOperatorDiv(GAnyPtr a, GAnyPtr b)
 {
     try {
-        return ganyCreatePtr((*reinterpret_cast<GAny *>(a)) / (*reinterpret_cast<GAny *>(b)));
+        return ganyCreatePtr((*ganyGet(a)) / (*ganyGet(b)));
     } catch (const std::exception &e) {
         printLogE(e.what());
         return ganyCreateUndefined();
@@ -853,7 +1771,7 @@ GAnyPtr ganyOperatorDiv(GAnyPtr a, GAnyPtr b)
 GAnyPtr ganyOperatorMod(GAnyPtr a, GAnyPtr b)
 {
     try {
-        return ganyCreatePtr((*reinterpret_cast<GAny *>(a)) % (*reinterpret_cast<GAny *>(b)));
+        return ganyCreatePtr((*ganyGet(a)) % (*ganyGet(b)));
     } catch (const std::exception &e) {
         printLogE(e.what());
         return ganyCreateUndefined();
@@ -863,7 +1781,7 @@ GAnyPtr ganyOperatorMod(GAnyPtr a, GAnyPtr b)
 GAnyPtr ganyOperatorBitXor(GAnyPtr a, GAnyPtr b)
 {
     try {
-        return ganyCreatePtr((*reinterpret_cast<GAny *>(a)) ^ (*reinterpret_cast<GAny *>(b)));
+        return ganyCreatePtr((*ganyGet(a)) ^ (*ganyGet(b)));
     } catch (const std::exception &e) {
         printLogE(e.what());
         return ganyCreateUndefined();
@@ -873,7 +1791,7 @@ GAnyPtr ganyOperatorBitXor(GAnyPtr a, GAnyPtr b)
 GAnyPtr ganyOperatorBitOr(GAnyPtr a, GAnyPtr b)
 {
     try {
-        return ganyCreatePtr((*reinterpret_cast<GAny *>(a)) | (*reinterpret_cast<GAny *>(b)));
+        return ganyCreatePtr((*ganyGet(a)) | (*ganyGet(b)));
     } catch (const std::exception &e) {
         printLogE(e.what());
         return ganyCreateUndefined();
@@ -883,7 +1801,7 @@ GAnyPtr ganyOperatorBitOr(GAnyPtr a, GAnyPtr b)
 GAnyPtr ganyOperatorBitAnd(GAnyPtr a, GAnyPtr b)
 {
     try {
-        return ganyCreatePtr((*reinterpret_cast<GAny *>(a)) & (*reinterpret_cast<GAny *>(b)));
+        return ganyCreatePtr((*ganyGet(a)) & (*ganyGet(b)));
     } catch (const std::exception &e) {
         printLogE(e.what());
         return ganyCreateUndefined();
@@ -893,7 +1811,7 @@ GAnyPtr ganyOperatorBitAnd(GAnyPtr a, GAnyPtr b)
 GAnyPtr ganyOperatorBitNot(GAnyPtr v)
 {
     try {
-        return ganyCreatePtr(~(*reinterpret_cast<GAny *>(v)));
+        return ganyCreatePtr(~(*ganyGet(v)));
     } catch (const std::exception &e) {
         printLogE(e.what());
         return ganyCreateUndefined();
@@ -903,7 +1821,7 @@ GAnyPtr ganyOperatorBitNot(GAnyPtr v)
 bool ganyOperatorEqualTo(GAnyPtr a, GAnyPtr b)
 {
     try {
-        return (*reinterpret_cast<GAny *>(a)) == (*reinterpret_cast<GAny *>(b));
+        return (*ganyGet(a)) == (*ganyGet(b));
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -913,7 +1831,7 @@ bool ganyOperatorEqualTo(GAnyPtr a, GAnyPtr b)
 bool ganyOperatorLessThan(GAnyPtr a, GAnyPtr b)
 {
     try {
-        return (*reinterpret_cast<GAny *>(a)) < (*reinterpret_cast<GAny *>(b));
+        return (*ganyGet(a)) < (*ganyGet(b));
     } catch (const std::exception &e) {
         printLogE(e.what());
         return false;
@@ -38,12 +38,34 @@ GX_API void GX_API_CALL setPluginLoaders(const std::string &pluginType,
 
 GX_API void GX_API_CALL setPluginSearchPath(const std::string &path);
 
+GX_API void GX_API_CALL removePluginSearchPath(const std::string &path);
+
 GX_API const std::vector<std::string> &GX_API_CALL getPluginSearchPaths();
 
 GX_API bool GX_API_CALL loadPlugin(const std::string &searchPath, const std::string &libName);
 
 GX_API bool GX_API_CALL loadPlugin(const std::string &libName);
 
+/**
+ * @brief Persist resolved plugin library paths to a manifest file, and use it to skip the search path walk
+ *        on later runs. Entries are refreshed when a library's mtime or the search paths change.
+ */
+GX_API void GX_API_CALL setPluginManifest(const std::string &file);
+
+/**
+ * @brief Load several plugins. With concurrent set, libraries are located and opened on worker threads,
+ *        modules are still registered one by one in the given order.
+ * @return true when every plugin was loaded
+ */
+GX_API bool GX_API_CALL loadPlugins(const std::vector<std::string> &libNames, bool concurrent = true);
+
+/**
+ * @brief Defer opening a plugin until its namespaces are first looked up in the env.
+ *        Falls back to loadPlugin when the manifest does not know the plugin's namespaces yet, or when one of
+ *        them is already in the env (e.g. shared with a plugin that is loaded).
+ */
+GX_API bool GX_API_CALL loadPluginDeferred(const std::string &libName);
+
 GX_NS_END
 
 #endif //GX_GANY_CORE_H
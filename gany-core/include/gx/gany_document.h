@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2022 Gxin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GX_GANY_DOCUMENT_H
+#define GX_GANY_DOCUMENT_H
+
+#include <gx/gany.h>
+
+
+GX_NS_BEGIN
+
+/**
+ * @brief Offset-based binary document for GAny trees.
+ * The encoded buffer can be mapped into memory directly. Arrays and objects of a loaded document are
+ * exposed as lazy nodes (GAnyDocumentNode), values are only decoded on getItem/length/iteration,
+ * and a node is materialized into a regular GAnyObject/GAnyArray on mutation or clone().
+ */
+class GX_API GAnyDocument
+{
+public:
+    /**
+     * @brief Encode a GAny tree into a binary document.
+     * @param value Root value
+     * @return Document buffer
+     */
+    static std::string encode(const GAny &value);
+
+    /**
+     * @brief Encode a GAny tree and write it to a file.
+     * @param value     Root value
+     * @param filePath  Output file path
+     * @return
+     */
+    static bool save(const GAny &value, const std::string &filePath);
+
+    /**
+     * @brief Load a document from a buffer, the buffer is owned by the returned nodes.
+     * @param buffer    Document buffer
+     * @return Root value, undefined if the buffer is not a valid document
+     */
+    static GAny decode(std::string buffer);
+
+    /**
+     * @brief Map a document file into memory, the mapping is released with the last node referring to it.
+     * @param filePath  Document file path
+     * @return Root value, undefined if the file is not a valid document
+     */
+    static GAny load(const std::string &filePath);
+};
+
+GX_NS_END
+
+#endif //GX_GANY_DOCUMENT_H
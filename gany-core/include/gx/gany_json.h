@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2022 Gxin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GX_GANY_JSON_H
+#define GX_GANY_JSON_H
+
+#include <gx/gany.h>
+
+
+GX_NS_BEGIN
+
+/**
+ * @brief JSON parsing options beyond GAny::parseJson.
+ */
+class GX_API GAnyJson
+{
+public:
+    /**
+     * @brief Parse JSON with interned object keys.
+     * Objects are built as GAnyInternedObject: keys are stored once in a table shared by every object of
+     * the result and matched by address, so large arrays of records keep one copy of each key.
+     * These objects support getItem/setItem/delItem/length/iteration, isObject() is false for them and
+     * toObject() converts one into a regular GAnyObject.
+     * @param json          JSON text
+     * @param rawNumbers    Keep numbers as GAnyNumber, same as GAny::parseJson
+     * @return Parsed value, an empty object on syntax errors
+     */
+    static GAny parseInterned(const std::string &json, bool rawNumbers = false);
+};
+
+GX_NS_END
+
+#endif //GX_GANY_JSON_H
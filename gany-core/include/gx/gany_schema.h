@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2022 Gxin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GX_GANY_SCHEMA_H
+#define GX_GANY_SCHEMA_H
+
+#include <gx/gany.h>
+
+
+GX_NS_BEGIN
+
+class GAnySchemaImpl;
+
+/**
+ * @brief Precompiled JSON Schema (draft-04) validator.
+ * A schema is compiled once and can be shared between threads. Values are validated by walking
+ * the GAny tree directly, JSON text is validated while it is being parsed.
+ */
+class GX_API GAnySchema
+{
+public:
+    GAnySchema() = default;
+
+    /**
+     * @brief Compile a schema from a GAny tree.
+     * @param schema    Schema object
+     * @param error     Receives the error message on failure, can be null
+     * @return Compiled schema, invalid on failure
+     */
+    static GAnySchema compile(const GAny &schema, std::string *error = nullptr);
+
+    /**
+     * @brief Compile a schema from JSON text.
+     * @param schemaJson    Schema JSON
+     * @param error         Receives the error message on failure, can be null
+     * @return Compiled schema, invalid on failure
+     */
+    static GAnySchema parse(const std::string &schemaJson, std::string *error = nullptr);
+
+    bool isValid() const;
+
+    /**
+     * @brief Validate a GAny tree, the value is not serialized.
+     * @param value Value to validate
+     * @param error Receives the first violation on failure, can be null
+     * @return
+     */
+    bool validate(const GAny &value, std::string *error = nullptr) const;
+
+    /**
+     * @brief Validate JSON text without building a GAny tree.
+     * @param json  JSON text
+     * @param error Receives the parse error or the first violation on failure, can be null
+     * @return
+     */
+    bool validateJson(const std::string &json, std::string *error = nullptr) const;
+
+    /**
+     * @brief Parse JSON text and validate it in a single pass.
+     * @param json  JSON text
+     * @param error Receives the parse error or the first violation on failure, can be null
+     * @return Parsed value, undefined on failure
+     */
+    GAny parseJson(const std::string &json, std::string *error = nullptr) const;
+
+private:
+    std::shared_ptr<GAnySchemaImpl> mImpl;
+};
+
+GX_NS_END
+
+#endif //GX_GANY_SCHEMA_H
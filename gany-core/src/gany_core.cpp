@@ -29,10 +29,17 @@
 #include "gany_iterator.h"
 
 #include "ref_gstring.h"
+#include "gany_document_node.h"
+#include "gany_interned_object.h"
+#include "ref_gany_schema.h"
 
 #include <utility>
 #include <sys/stat.h>
 #include <fstream>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <mutex>
 
 #if GX_PLATFORM_WINDOWS
 
@@ -85,6 +92,25 @@ bool fileExists(const GString &path)
 #endif
 }
 
+int64_t fileModifiedTime(const GString &path)
+{
+    if (path.isEmpty()) {
+        return -1;
+    }
+#if GX_PLATFORM_WINDOWS
+    struct _stat64 fstat{};
+    if (_wstat64(path.toUtf16().data(), &fstat) != 0) {
+        return -1;
+    }
+#else
+    struct stat fstat{};
+    if (stat(path.c_str(), &fstat) != 0) {
+        return -1;
+    }
+#endif
+    return (int64_t) fstat.st_mtime;
+}
+
 GString formatPath(GString path)
 {
     if (path.isEmpty()) {
@@ -172,12 +198,163 @@ void GX_API_CALL setPluginSearchPath(const std::string &path)
     searchPaths.push_back(absPath);
 }
 
+void GX_API_CALL removePluginSearchPath(const std::string &path)
+{
+    std::string absPath = fileExists(path) ? absoluteFilePath(path).toStdString() : path;
+
+    auto &searchPaths = pluginSearchPaths();
+    searchPaths.erase(std::remove(searchPaths.begin(), searchPaths.end(), absPath), searchPaths.end());
+}
+
 const std::vector<std::string> &GX_API_CALL getPluginSearchPaths()
 {
     return pluginSearchPaths();
 }
 
-bool loadCPlugin(const std::string &searchPath, const std::string &pluginName)
+/// ================ Plugin manifest ================
+
+struct PluginManifestEntry
+{
+    std::string path;
+    int64_t mtime = -1;
+    std::vector<std::string> namespaces;
+};
+
+/**
+ * Resolved C/C++ plugin libraries keyed by plugin name ("lib/Module"), so that repeated loads skip the
+ * search path walk. When a manifest file is set the index is also persisted across runs. An entry is only
+ * trusted while the library's mtime and the search path list are unchanged.
+ */
+class PluginManifest
+{
+public:
+    void open(const std::string &file)
+    {
+        std::lock_guard locker(mLock);
+        mFile = file;
+        mSearchPaths = pluginSearchPaths();
+        mEntries.clear();
+        mDirty = false;
+
+        std::ifstream ifs(file);
+        if (!ifs.is_open()) {
+            return;
+        }
+        std::stringstream sst;
+        sst << ifs.rdbuf();
+        GAny manifest = GAny::parseJson(sst.str());
+        if (manifest["searchPaths"].toJsonString() != GAny(mSearchPaths).toJsonString()) {
+            return;
+        }
+        for (auto it = manifest["plugins"].iterator(); it.hasNext();) {
+            auto item = it.next();
+            PluginManifestEntry entry;
+            entry.path = item.second["path"].toString();
+            entry.mtime = item.second["mtime"].toInt64();
+            for (size_t i = 0; i < item.second["namespaces"].size(); i++) {
+                entry.namespaces.push_back(item.second["namespaces"][i].toString());
+            }
+            mEntries[item.first.toString()] = std::move(entry);
+        }
+    }
+
+    bool lookup(const std::string &pluginName, PluginManifestEntry &entry)
+    {
+        std::lock_guard locker(mLock);
+        checkSearchPaths();
+        auto it = mEntries.find(pluginName);
+        if (it == mEntries.end()) {
+            return false;
+        }
+        if (fileModifiedTime(it->second.path) != it->second.mtime) {
+            mEntries.erase(it);
+            mDirty = true;
+            return false;
+        }
+        entry = it->second;
+        return true;
+    }
+
+    void update(const std::string &pluginName, const std::string &path, const std::vector<std::string> &namespaces)
+    {
+        std::lock_guard locker(mLock);
+        checkSearchPaths();
+        auto &entry = mEntries[pluginName];
+        entry.path = path;
+        entry.mtime = fileModifiedTime(path);
+        if (!namespaces.empty()) {
+            entry.namespaces = namespaces;
+        }
+        mDirty = true;
+    }
+
+    void save()
+    {
+        std::lock_guard locker(mLock);
+        if (!mDirty || mFile.empty()) {
+            return;
+        }
+        GAny plugins = GAny::object();
+        for (const auto &item: mEntries) {
+            GAny entry = GAny::object();
+            entry["path"] = item.second.path;
+            entry["mtime"] = item.second.mtime;
+            entry["namespaces"] = item.second.namespaces;
+            plugins[item.first] = entry;
+        }
+        GAny manifest = GAny::object();
+        manifest["searchPaths"] = mSearchPaths;
+        manifest["plugins"] = plugins;
+
+        std::ofstream ofs(mFile, std::ios::trunc);
+        if (!ofs.is_open()) {
+            std::cerr << "Failed to write plugin manifest " << mFile << std::endl;
+            return;
+        }
+        ofs << manifest.toJsonString(2);
+        mDirty = false;
+    }
+
+private:
+    void checkSearchPaths()
+    {
+        if (mSearchPaths != pluginSearchPaths()) {
+            mSearchPaths = pluginSearchPaths();
+            mDirty = mDirty || !mEntries.empty();
+            mEntries.clear();
+        }
+    }
+
+private:
+    std::mutex mLock;
+    std::string mFile;
+    std::vector<std::string> mSearchPaths;
+    std::unordered_map<std::string, PluginManifestEntry> mEntries;
+    bool mDirty = false;
+};
+
+static PluginManifest &pluginManifest()
+{
+    static PluginManifest sManifest;
+    return sManifest;
+}
+
+void GX_API_CALL setPluginManifest(const std::string &file)
+{
+    pluginManifest().open(file);
+}
+
+/// ================ C/C++ plugin loading ================
+
+struct CPluginLibrary
+{
+    std::string pluginName;
+    std::string moduleName;
+    std::string path;
+    RegisterModuleFunc regFunc = nullptr;
+};
+
+static bool splitCPluginName(const std::string &pluginName, std::string &libName, std::string &moduleName)
 {
     GString pluginNameStr = pluginName;
     int64_t lastSplitIndex = pluginNameStr.lastIndexOf("/");
@@ -185,9 +362,13 @@ bool loadCPlugin(const std::string &searchPath, const std::string &pluginName)
         std::cerr << "Invalid C/C++ plugin naming." << std::endl;
         return false;
     }
-    std::string libName = pluginNameStr.substring(0, lastSplitIndex).toStdString();
-    std::string moduleName = pluginNameStr.substring(lastSplitIndex + 1).toStdString();
+    libName = pluginNameStr.substring(0, lastSplitIndex).toStdString();
+    moduleName = pluginNameStr.substring(lastSplitIndex + 1).toStdString();
+    return true;
+}
 
+static GString findCPluginLibrary(const std::string &searchPath, const std::string &libName)
+{
     GString dir = absoluteFilePath(searchPath);
     GString libFile = dir + "/" + libName;
     while (!fileExists(libFile)) {
@@ -230,20 +411,80 @@ bool loadCPlugin(const std::string &searchPath, const std::string &pluginName)
 #endif
         break;
     }
+    return fileExists(libFile) ? libFile : GString();
+}
 
-    if (fileExists(libFile)) {
-        void *lib = dlOpen(libFile.c_str());
-        void *regFuncPtr = dlSym(lib, "Register" + moduleName);
-        if (!regFuncPtr) {
-            return false;
+/**
+ * Resolve the library of a plugin through the manifest, or by walking the search paths in priority order.
+ */
+static bool resolveCPlugin(const std::string &pluginName, CPluginLibrary &plugin)
+{
+    std::string libName;
+    if (!splitCPluginName(pluginName, libName, plugin.moduleName)) {
+        return false;
+    }
+    plugin.pluginName = pluginName;
+
+    PluginManifestEntry entry;
+    if (pluginManifest().lookup(pluginName, entry)) {
+        plugin.path = entry.path;
+        return true;
+    }
+    const auto &searchPaths = pluginSearchPaths();
+    for (auto it = searchPaths.rbegin(); it != searchPaths.rend(); it++) {
+        GString libFile = findCPluginLibrary(*it, libName);
+        if (!libFile.isEmpty()) {
+            plugin.path = libFile.toStdString();
+            return true;
         }
-        auto regFunc = (RegisterModuleFunc) regFuncPtr;
-        int32_t retCode = regFunc(GANY_VERSION_CODE, pfnGanyGetEnv, pfnGanyParseJson, pfnGanyRegisterToEnv, pfnGanyClassInstance);
-        return retCode == 0;
     }
     return false;
 }
 
+/**
+ * dlopen the resolved library and look up its Register function. Safe to run concurrently.
+ */
+static bool openCPlugin(CPluginLibrary &plugin)
+{
+    void *lib = dlOpen(plugin.path);
+    if (!lib) {
+        return false;
+    }
+    plugin.regFunc = (RegisterModuleFunc) dlSym(lib, "Register" + plugin.moduleName);
+    return plugin.regFunc != nullptr;
+}
+
+/**
+ * Run the module registration and record the library, together with the env namespaces its classes were
+ * registered under, in the manifest.
+ */
+static bool registerCPlugin(const CPluginLibrary &plugin)
+{
+    GAnyEnvRegisterRecorder recorder;
+    int32_t retCode = plugin.regFunc(GANY_VERSION_CODE, pfnGanyGetEnv, pfnGanyParseJson, pfnGanyRegisterToEnv,
+                                     pfnGanyClassInstance);
+    if (retCode != 0) {
+        return false;
+    }
+    pluginManifest().update(plugin.pluginName, plugin.path, recorder.names());
+    return true;
+}
+
+bool loadCPlugin(const std::string &searchPath, const std::string &pluginName)
+{
+    CPluginLibrary plugin;
+    std::string libName;
+    if (!splitCPluginName(pluginName, libName, plugin.moduleName)) {
+        return false;
+    }
+    plugin.pluginName = pluginName;
+    plugin.path = findCPluginLibrary(searchPath, libName).toStdString();
+    if (plugin.path.empty() || !openCPlugin(plugin)) {
+        return false;
+    }
+    return registerCPlugin(plugin);
+}
+
 bool _loadPlugin(const std::string &searchPath, const std::string &pluginName)
 {
     if (loadCPlugin(searchPath, pluginName)) {
@@ -270,6 +511,7 @@ bool GX_API_CALL loadPlugin(const std::string &searchPath, const std::string &pl
         return false;
     }
     if (_loadPlugin(searchPath, pluginName)) {
+        pluginManifest().save();
         return true;
     }
 
@@ -277,8 +519,25 @@ bool GX_API_CALL loadPlugin(const std::string &searchPath, const std::string &pl
     return false;
 }
 
-bool GX_API_CALL loadPlugin(const std::string &pluginName)
+static bool loadPluginNoSave(const std::string &pluginName)
 {
+    PluginManifestEntry entry;
+    if (pluginManifest().lookup(pluginName, entry)) {
+        CPluginLibrary plugin;
+        std::string libName;
+        if (splitCPluginName(pluginName, libName, plugin.moduleName)) {
+            plugin.pluginName = pluginName;
+            plugin.path = entry.path;
+            if (openCPlugin(plugin)) {
+                // Walking the search paths would find and register the same module again.
+                if (registerCPlugin(plugin)) {
+                    return true;
+                }
+                std::cerr << "loadPlugin, plugin " << pluginName << " load failed." << std::endl;
+                return false;
+            }
+        }
+    }
     const auto &searchPaths = getPluginSearchPaths();
     for (auto it = searchPaths.rbegin(); it != searchPaths.rend(); it++) {
         if (_loadPlugin(*it, pluginName)) {
@@ -289,6 +548,75 @@ bool GX_API_CALL loadPlugin(const std::string &pluginName)
     return false;
 }
 
+bool GX_API_CALL loadPlugin(const std::string &pluginName)
+{
+    bool ret = loadPluginNoSave(pluginName);
+    pluginManifest().save();
+    return ret;
+}
+
+bool GX_API_CALL loadPlugins(const std::vector<std::string> &pluginNames, bool concurrent)
+{
+    // Resolving and dlopen-ing libraries is independent per plugin, registration into the env stays serial
+    // and in the given order.
+    std::vector<CPluginLibrary> plugins(pluginNames.size());
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < plugins.size(); i = next++) {
+            if (!resolveCPlugin(pluginNames[i], plugins[i]) || !openCPlugin(plugins[i])) {
+                plugins[i].regFunc = nullptr;
+            }
+        }
+    };
+    size_t threadCount = concurrent ? std::min<size_t>(std::max(std::thread::hardware_concurrency(), 2u),
+                                                       plugins.size()) : 0;
+    if (threadCount > 1) {
+        std::vector<std::thread> threads;
+        threads.reserve(threadCount);
+        for (size_t i = 0; i < threadCount; i++) {
+            threads.emplace_back(worker);
+        }
+        for (auto &t: threads) {
+            t.join();
+        }
+    } else {
+        worker();
+    }
+
+    bool ret = true;
+    for (size_t i = 0; i < plugins.size(); i++) {
+        if (plugins[i].regFunc) {
+            // A module that failed to register is not run again through the fallback.
+            if (!registerCPlugin(plugins[i])) {
+                std::cerr << "loadPlugin, plugin " << pluginNames[i] << " load failed." << std::endl;
+                ret = false;
+            }
+            continue;
+        }
+        // Not a C/C++ plugin found on the search paths, let the other loaders try.
+        ret = loadPluginNoSave(pluginNames[i]) && ret;
+    }
+    pluginManifest().save();
+    return ret;
+}
+
+bool GX_API_CALL loadPluginDeferred(const std::string &pluginName)
+{
+    PluginManifestEntry entry;
+    if (!pluginManifest().lookup(pluginName, entry) || entry.namespaces.empty()) {
+        // Namespaces are only known after a first load, which fills the manifest.
+        return loadPlugin(pluginName);
+    }
+    auto stub = std::make_shared<GAnyLazyEnvStub>([pluginName]() {
+        loadPlugin(pluginName);
+    });
+    if (!getEnvObject().setLazy(entry.namespaces, stub)) {
+        // A namespace is already provided by another plugin, so a lookup would never reach this one.
+        return loadPlugin(pluginName);
+    }
+    return true;
+}
+
 static void initPluginLoader()
 {
     setPluginSearchPath("./");  // The search path is a reversed list, with higher priority given to items added later
@@ -302,7 +630,13 @@ static void initPluginLoader()
 
     getEnvObject().set("loadPlugin", loadPluginFunc);
     getEnvObject().set("setPluginSearchPath", &setPluginSearchPath);
+    getEnvObject().set("removePluginSearchPath", &removePluginSearchPath);
     getEnvObject().set("getPluginSearchPaths", &getPluginSearchPaths);
+    getEnvObject().set("setPluginManifest", &setPluginManifest);
+    getEnvObject().set("loadPlugins", [](const std::vector<std::string> &pluginNames, bool concurrent) {
+        return loadPlugins(pluginNames, concurrent);
+    });
+    getEnvObject().set("loadPluginDeferred", &loadPluginDeferred);
     getEnvObject().set("setPluginLoaders", [](const std::string &pluginType, const GAny &loaderFunc) {
         if (!loaderFunc.isFunction()) {
             return ;
@@ -994,6 +1328,68 @@ REGISTER_GANY_MODULE(Builtin)
                 return ss.str();
             });
 
+    Class<GAnyPath>("", "GAnyPath", "Compiled element path, supports dotted, bracket and JSON Pointer syntax.")
+            .construct<const std::string &>()
+            .func(MetaFunction::ToString, [](GAnyPath &self) {
+                return self.toString();
+            })
+            .func("isValid", &GAnyPath::isValid)
+            .func("hasWildcard", &GAnyPath::hasWildcard)
+            .func("get", &GAnyPath::get, "Get the element matched by the path.")
+            .func("getItems", [](GAnyPath &self, const GAny &root, const GAny &func) {
+                // func: function(const GAny &value)->bool
+                self.getItems(root, [&func](const GAny &v) {
+                    auto ret = func(v);
+                    return !(ret.isBoolean() && !ret.toBool());
+                });
+            }, "Visit all elements matched by the path.");
+
+    Class<GAnyNumber>("", "GAnyNumber", "JSON number kept as its source text.")
+            .construct<std::string>()
+            .func(MetaFunction::ToString, [](GAnyNumber &self) {
+                return self.text();
+            })
+            .func(MetaFunction::ToInt32, [](GAnyNumber &self) {
+                return (int32_t) self.toInt64();
+            })
+            .func(MetaFunction::ToInt64, [](GAnyNumber &self) {
+                return self.toInt64();
+            })
+            .func(MetaFunction::ToDouble, [](GAnyNumber &self) {
+                return self.toDouble();
+            })
+            .func(MetaFunction::ToBoolean, [](GAnyNumber &self) {
+                return self.isInteger() ? self.toInt64() != 0 : self.toDouble() != 0;
+            })
+            .func(MetaFunction::EqualTo, [](GAnyNumber &self, const GAny &rh) {
+                if (rh.is<GAnyNumber>()) {
+                    const auto &other = rh.as<GAnyNumber>();
+                    if (self.text() == other.text()) {
+                        return true;
+                    }
+                    if (self.isInteger() && other.isInteger()) {
+                        return self.toInt64() == other.toInt64();
+                    }
+                    return self.toDouble() == other.toDouble();
+                }
+                if (!rh.isNumber()) {
+                    return false;
+                }
+                if (self.isInteger() && !rh.isFloat() && !rh.isDouble()) {
+                    return self.toInt64() == rh.toInt64();
+                }
+                return self.toDouble() == rh.toDouble();
+            })
+            .func(MetaFunction::LessThan, [](GAnyNumber &self, const GAny &rh) {
+                if (self.isInteger() && (rh.is<GAnyNumber>() ? rh.as<GAnyNumber>().isInteger()
+                                                             : rh.isNumber() && !rh.isFloat() && !rh.isDouble())) {
+                    return self.toInt64() < rh.toInt64();
+                }
+                return self.toDouble() < rh.toDouble();
+            })
+            .func("text", &GAnyNumber::text)
+            .func("isInteger", &GAnyNumber::isInteger);
+
     GAnyClass::Class < std::pair<const std::string, GAny>>()
             ->setName("GAnyObjectPair")
             .property("first", [](std::pair<const std::string, GAny> &self) -> std::string {
@@ -1058,9 +1454,16 @@ REGISTER_GANY_MODULE(Builtin)
             })
             .func(MetaFunction::GetItem, &GAnyEnvObject::get)
             .func("contains", &GAnyEnvObject::contains)
+            .func("isLazy", &GAnyEnvObject::isLazy)
+            .func("exportLazy", [](GAnyEnvObject &self, const std::string &name, const GAny &loader) {
+                if (!loader.isFunction()) {
+                    return false;
+                }
+                return self.setLazy(name, std::make_shared<GAnyLazyEnvStub>(loader));
+            })
             .func("forEach", [](GAnyEnvObject &self, const GAny &func) {
                 // func: function(const std::string &key, const GAny &value)->bool
-                GLockerGuard locker(self.lock);
+                std::shared_lock locker(self.lock);
                 for (auto &item: self.var) {
                     auto ret = func(item.first, item.second);
                     if (ret.isBoolean() && !ret.toBool()) {
@@ -1150,6 +1553,9 @@ REGISTER_GANY_MODULE(Builtin)
             });
 
     refGString();
+    refGAnyDocument();
+    refGAnyInternedObject();
+    refGAnySchema();
 }
 
 #include "gany_pfn_impl.h"
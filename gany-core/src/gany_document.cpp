@@ -0,0 +1,721 @@
+/*
+ * Copyright (c) 2022 Gxin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gany_document_node.h"
+
+#include "gx/gany_document.h"
+
+#include <fstream>
+
+#if GX_PLATFORM_WINDOWS
+
+#include <windows.h>
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#endif
+
+#define GANY_DOC_MAGIC "GADC"
+#define GANY_DOC_VERSION 1
+
+
+GX_NS_BEGIN
+
+/// ================ GAnyDocumentStorage ================
+
+GAnyDocumentStorage::GAnyDocumentStorage(std::string buffer)
+        : mBuffer(std::move(buffer))
+{
+    mData = (const uint8_t *) mBuffer.data();
+    mSize = mBuffer.size();
+}
+
+GAnyDocumentStorage::~GAnyDocumentStorage()
+{
+#if GX_PLATFORM_WINDOWS
+    if (mData && mMapping) {
+        ::UnmapViewOfFile(mData);
+    }
+    if (mMapping) {
+        ::CloseHandle((HANDLE) mMapping);
+    }
+    if (mFile) {
+        ::CloseHandle((HANDLE) mFile);
+    }
+#else
+    if (mMapping) {
+        ::munmap(mMapping, mSize);
+    }
+#endif
+}
+
+std::shared_ptr<GAnyDocumentStorage> GAnyDocumentStorage::mapFile(const std::string &filePath)
+{
+#if GX_PLATFORM_WINDOWS
+    GWString wPath = GString(filePath).toUtf16();
+    HANDLE file = ::CreateFileW(wPath.data(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+    LARGE_INTEGER fileSize;
+    if (!::GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0) {
+        ::CloseHandle(file);
+        return nullptr;
+    }
+    HANDLE mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        ::CloseHandle(file);
+        return nullptr;
+    }
+    void *addr = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!addr) {
+        ::CloseHandle(mapping);
+        ::CloseHandle(file);
+        return nullptr;
+    }
+    std::shared_ptr<GAnyDocumentStorage> storage(GX_NEW(GAnyDocumentStorage));
+    storage->mFile = file;
+    storage->mMapping = mapping;
+    storage->mData = (const uint8_t *) addr;
+    storage->mSize = (size_t) fileSize.QuadPart;
+    return storage;
+#else
+    int fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat fstat{};
+    if (::fstat(fd, &fstat) != 0 || fstat.st_size <= 0) {
+        ::close(fd);
+        return nullptr;
+    }
+    void *addr = ::mmap(nullptr, (size_t) fstat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        return nullptr;
+    }
+    std::shared_ptr<GAnyDocumentStorage> storage(GX_NEW(GAnyDocumentStorage));
+    storage->mMapping = addr;
+    storage->mData = (const uint8_t *) addr;
+    storage->mSize = (size_t) fstat.st_size;
+    return storage;
+#endif
+}
+
+/// ================ Encoder ================
+
+class GAnyDocumentEncoder
+{
+public:
+    GAnyDocumentEncoder()
+    {
+        mBuffer.resize(sizeof(DocHeader));
+    }
+
+    std::string finish(const GAny &root)
+    {
+        DocHeader header{};
+        memcpy(header.magic, GANY_DOC_MAGIC, sizeof(header.magic));
+        header.version = GANY_DOC_VERSION;
+        header.root = encode(root);
+        header.size = mBuffer.size();
+        memcpy(&mBuffer[0], &header, sizeof(DocHeader));
+        return std::move(mBuffer);
+    }
+
+private:
+    template<typename T>
+    static DocSlot makeSlot(DocType type, uint32_t length, T payload)
+    {
+        static_assert(sizeof(T) <= sizeof(uint64_t), "Payload must fit in 8 bytes.");
+        DocSlot slot{};
+        slot.type = type;
+        slot.length = length;
+        memcpy(&slot.payload, &payload, sizeof(T));
+        return slot;
+    }
+
+    static uint32_t checkLength(size_t length)
+    {
+        if (length > UINT32_MAX) {
+            throw GAnyException("GAnyDocument: string or container is too large.");
+        }
+        return (uint32_t) length;
+    }
+
+    uint64_t allocate(size_t size)
+    {
+        const size_t offset = (mBuffer.size() + 7) & ~(size_t) 7;
+        mBuffer.resize(offset + size);
+        return offset;
+    }
+
+    uint64_t writeString(const std::string &str)
+    {
+        // The extra byte is the '\0' terminator, resize() already zero-fills it.
+        const uint64_t offset = allocate(str.size() + 1);
+        memcpy(&mBuffer[offset], str.data(), str.size());
+        return offset;
+    }
+
+    DocSlot encode(const GAny &v)
+    {
+        switch (v.type()) {
+            case AnyType::null_t:
+                return makeSlot(DocType::Null, 0, (uint64_t) 0);
+            case AnyType::boolean_t:
+                return makeSlot(DocType::Boolean, 0, (uint64_t) (v.toBool() ? 1 : 0));
+            case AnyType::int8_t:
+            case AnyType::int16_t:
+            case AnyType::int32_t: {
+                if (v.is<uint8_t>() || v.is<uint16_t>() || v.is<uint32_t>()) {
+                    return makeSlot(DocType::UInt32, 0, (uint32_t) v.toInt64());
+                }
+                return makeSlot(DocType::Int32, 0, v.toInt32());
+            }
+            case AnyType::int64_t: {
+                if (v.is<uint64_t>()) {
+                    return makeSlot(DocType::UInt64, 0, v.as<uint64_t>());
+                }
+                return makeSlot(DocType::Int64, 0, v.toInt64());
+            }
+            case AnyType::float_t:
+                return makeSlot(DocType::Float, 0, v.toFloat());
+            case AnyType::double_t:
+                return makeSlot(DocType::Double, 0, v.toDouble());
+            case AnyType::string_t: {
+                const auto &str = v.as<std::string>();
+                const uint32_t length = checkLength(str.size());
+                return makeSlot(DocType::String, length, writeString(str));
+            }
+            case AnyType::array_t: {
+                const auto &arr = v.as<GAnyArray>();
+                GLockerGuard locker(arr.lock);
+                const uint32_t count = checkLength(arr.var.size());
+                const uint64_t offset = allocate(sizeof(DocSlot) * count);
+                for (uint32_t i = 0; i < count; i++) {
+                    DocSlot slot = encode(arr.var[i]);
+                    memcpy(&mBuffer[offset + sizeof(DocSlot) * i], &slot, sizeof(DocSlot));
+                }
+                return makeSlot(DocType::Array, count, offset);
+            }
+            case AnyType::object_t: {
+                const auto &obj = v.as<GAnyObject>();
+                GLockerGuard locker(obj.lock);
+                std::vector<const std::pair<const std::string, GAny> *> items;
+                items.reserve(obj.var.size());
+                for (const auto &item: obj.var) {
+                    if (!item.second.isUndefined()) {
+                        items.push_back(&item);
+                    }
+                }
+                std::sort(items.begin(), items.end(), [](const auto *a, const auto *b) {
+                    return a->first < b->first;
+                });
+
+                const uint32_t count = checkLength(items.size());
+                const uint64_t offset = allocate(sizeof(DocEntry) * count);
+                for (uint32_t i = 0; i < count; i++) {
+                    DocEntry entry{};
+                    entry.keyLength = checkLength(items[i]->first.size());
+                    entry.keyOffset = writeString(items[i]->first);
+                    entry.value = encode(items[i]->second);
+                    memcpy(&mBuffer[offset + sizeof(DocEntry) * i], &entry, sizeof(DocEntry));
+                }
+                return makeSlot(DocType::Object, count, offset);
+            }
+            case AnyType::user_obj_t: {
+                if (v.is<GAnyNumber>()) {
+                    // The binary format has no decimal type, raw numbers are stored as int64 or double.
+                    const auto &num = v.as<GAnyNumber>();
+                    if (num.isInteger() && num.text()[0] != '-' && num.toInt64() < 0) {
+                        return makeSlot(DocType::UInt64, 0, (uint64_t) num.toInt64());
+                    }
+                    return num.isInteger()
+                           ? makeSlot(DocType::Int64, 0, num.toInt64())
+                           : makeSlot(DocType::Double, 0, num.toDouble());
+                }
+                if (v.classObject().containsMember(MetaFunction::ToObject)) {
+                    return encode(v.toObject());
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        // Values without a data representation (functions, classes...) are stored as undefined.
+        return makeSlot(DocType::Undefined, 0, (uint64_t) 0);
+    }
+
+private:
+    std::string mBuffer;
+};
+
+/// ================ GAnyDocumentNode ================
+
+GAnyDocumentNode::GAnyDocumentNode(std::shared_ptr<const GAnyDocumentStorage> storage, const DocSlot &slot,
+                                   std::weak_ptr<GAnyDocumentChildren> parent, uint32_t indexInParent)
+        : mStorage(std::move(storage)), mSlot(slot),
+          mChildren(std::make_shared<GAnyDocumentChildren>(std::move(parent), indexInParent))
+{}
+
+size_t GAnyDocumentNode::length() const
+{
+    if (const GAny *l = local()) {
+        return l->length();
+    }
+    return mSlot.length;
+}
+
+GAny GAnyDocumentNode::clone() const
+{
+    return materialize(true);
+}
+
+GAny GAnyDocumentNode::getItem(const GAny &i) const
+{
+    if (const GAny *l = local()) {
+        return l->getItem(i);
+    }
+    if (isArray()) {
+        if (!i.isNumber()) {
+            return GAny::undefined();
+        }
+        const int64_t index = i.toInt64();
+        if (index < 0 || index >= mSlot.length) {
+            return GAny::undefined();
+        }
+        return child((uint32_t) index, slotAt((uint32_t) index), false);
+    }
+    if (!i.isString()) {
+        return GAny::undefined();
+    }
+    uint32_t index;
+    if (!findEntry(i.as<std::string>(), index)) {
+        return GAny::undefined();
+    }
+    return child(index, entryAt(index).value, false);
+}
+
+void GAnyDocumentNode::setItem(const GAny &i, const GAny &v)
+{
+    mutableLocal().setItem(i, v);
+}
+
+void GAnyDocumentNode::delItem(const GAny &i)
+{
+    mutableLocal().delItem(i);
+}
+
+GAny GAnyDocumentNode::materialize(bool deep) const
+{
+    if (const GAny *l = local()) {
+        return deep ? l->clone() : *l;
+    }
+
+    if (isArray()) {
+        std::vector<GAny> vec;
+        vec.reserve(mSlot.length);
+        for (uint32_t i = 0; i < mSlot.length; i++) {
+            vec.push_back(child(i, slotAt(i), deep));
+        }
+        return (std::shared_ptr<GAnyValue>) std::make_shared<GAnyArray>(std::move(vec));
+    }
+
+    std::unordered_map<std::string, GAny> map;
+    map.reserve(mSlot.length);
+    for (uint32_t i = 0; i < mSlot.length; i++) {
+        const auto entry = entryAt(i);
+        if (!mStorage->contains(entry.keyOffset, entry.keyLength)) {
+            continue;
+        }
+        map.emplace(std::string((const char *) mStorage->data() + entry.keyOffset, entry.keyLength),
+                    child(i, entry.value, deep));
+    }
+    return (std::shared_ptr<GAnyValue>) std::make_shared<GAnyObject>(std::move(map));
+}
+
+GAny GAnyDocumentNode::iterator(const GAny &self) const
+{
+    if (const GAny *l = local()) {
+        return l->iterator();
+    }
+    return std::make_unique<GAnyDocumentIterator>(self);
+}
+
+GAny GAnyDocumentNode::decode(const std::shared_ptr<const GAnyDocumentStorage> &storage, const DocSlot &slot,
+                              bool deep)
+{
+    switch (slot.type) {
+        case DocType::Null:
+            return GAny::null();
+        case DocType::Boolean:
+            return slot.payload != 0;
+        case DocType::Int32: {
+            int32_t v;
+            memcpy(&v, &slot.payload, sizeof(v));
+            return v;
+        }
+        case DocType::UInt32: {
+            uint32_t v;
+            memcpy(&v, &slot.payload, sizeof(v));
+            return v;
+        }
+        case DocType::Int64: {
+            int64_t v;
+            memcpy(&v, &slot.payload, sizeof(v));
+            return v;
+        }
+        case DocType::UInt64:
+            return slot.payload;
+        case DocType::Float: {
+            float v;
+            memcpy(&v, &slot.payload, sizeof(v));
+            return v;
+        }
+        case DocType::Double: {
+            double v;
+            memcpy(&v, &slot.payload, sizeof(v));
+            return v;
+        }
+        case DocType::String: {
+            if (!storage->contains(slot.payload, slot.length)) {
+                break;
+            }
+            return std::string((const char *) storage->data() + slot.payload, slot.length);
+        }
+        case DocType::Array:
+        case DocType::Object: {
+            const size_t itemSize = slot.type == DocType::Array ? sizeof(DocSlot) : sizeof(DocEntry);
+            if (!storage->contains(slot.payload, (uint64_t) slot.length * itemSize)) {
+                break;
+            }
+            if (deep) {
+                return GAnyDocumentNode(storage, slot).materialize(true);
+            }
+            return GAny((std::shared_ptr<GAnyValue>) std::make_shared<GAnyDocumentNode>(storage, slot));
+        }
+        default:
+            break;
+    }
+    return GAny::undefined();
+}
+
+const GAny *GAnyDocumentNode::local() const
+{
+    return mMaterialized.load(std::memory_order_acquire) ? &mLocal : nullptr;
+}
+
+GAny &GAnyDocumentNode::mutableLocal()
+{
+    if (!mMaterialized.load(std::memory_order_acquire)) {
+        GAny v = materialize(false);
+        GLockerGuard locker(mLock);
+        if (!mMaterialized.load(std::memory_order_relaxed)) {
+            mLocal = v;
+            mMaterialized.store(true, std::memory_order_release);
+        }
+        mChildren->pinSelf();
+    }
+    return mLocal;
+}
+
+GAny GAnyDocumentNode::child(uint32_t index, const DocSlot &slot, bool deep) const
+{
+    if (slot.type != DocType::Array && slot.type != DocType::Object) {
+        return decode(mStorage, slot, false);
+    }
+
+    GAny node = mChildren->find(index);
+    if (deep) {
+        return node.isUndefined() ? decode(mStorage, slot, true) : node.clone();
+    }
+    if (!node.isUndefined()) {
+        return node;
+    }
+
+    const size_t itemSize = slot.type == DocType::Array ? sizeof(DocSlot) : sizeof(DocEntry);
+    if (!mStorage->contains(slot.payload, (uint64_t) slot.length * itemSize)) {
+        return GAny::undefined();
+    }
+    node = GAny((std::shared_ptr<GAnyValue>) std::make_shared<GAnyDocumentNode>(mStorage, slot, mChildren, index));
+    mChildren->insert(index, node);
+    return node;
+}
+
+DocSlot GAnyDocumentNode::slotAt(uint32_t index) const
+{
+    return mStorage->read<DocSlot>(mSlot.payload + sizeof(DocSlot) * index);
+}
+
+DocEntry GAnyDocumentNode::entryAt(uint32_t index) const
+{
+    return mStorage->read<DocEntry>(mSlot.payload + sizeof(DocEntry) * index);
+}
+
+bool GAnyDocumentNode::findEntry(const std::string &key, uint32_t &index) const
+{
+    const uint8_t *data = mStorage->data();
+    uint32_t lo = 0;
+    uint32_t hi = mSlot.length;
+    while (lo < hi) {
+        const uint32_t mid = lo + (hi - lo) / 2;
+        const auto entry = entryAt(mid);
+        if (!mStorage->contains(entry.keyOffset, entry.keyLength)) {
+            return false;
+        }
+        const size_t n = std::min<size_t>(entry.keyLength, key.size());
+        int c = memcmp(data + entry.keyOffset, key.data(), n);
+        if (c == 0) {
+            c = entry.keyLength < key.size() ? -1 : (entry.keyLength > key.size() ? 1 : 0);
+        }
+        if (c == 0) {
+            index = mid;
+            return true;
+        }
+        if (c < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return false;
+}
+
+/// ================ GAnyDocumentIterator ================
+
+bool GAnyDocumentIterator::hasNext() const
+{
+    if (syncLocal()) {
+        return mHasPending;
+    }
+    return mIndex < mNode.as<GAnyDocumentNode>().mSlot.length;
+}
+
+GAnyIteratorItem GAnyDocumentIterator::next()
+{
+    if (syncLocal()) {
+        if (!mHasPending) {
+            return std::make_pair(nullptr, nullptr);
+        }
+        mHasPending = false;
+        return std::move(mPending);
+    }
+    const auto &node = mNode.as<GAnyDocumentNode>();
+    if (mIndex >= node.mSlot.length) {
+        return std::make_pair(nullptr, nullptr);
+    }
+    const uint32_t index = mIndex++;
+    if (node.isArray()) {
+        return std::make_pair((int32_t) index, node.child(index, node.slotAt(index), false));
+    }
+    const auto entry = node.entryAt(index);
+    if (!node.mStorage->contains(entry.keyOffset, entry.keyLength)) {
+        return std::make_pair(nullptr, nullptr);
+    }
+    return std::make_pair(std::string((const char *) node.mStorage->data() + entry.keyOffset, entry.keyLength),
+                          node.child(index, entry.value, false));
+}
+
+bool GAnyDocumentIterator::syncLocal() const
+{
+    const auto &node = mNode.as<GAnyDocumentNode>();
+    if (mLocalIter.isUndefined()) {
+        const GAny *l = node.local();
+        if (!l) {
+            return false;
+        }
+        mLocalIter = l->iterator();
+        if (node.isArray()) {
+            // Positions before mIndex have been returned already.
+            for (uint32_t i = 0; i < mIndex && mLocalIter.hasNext(); i++) {
+                mLocalIter.next();
+            }
+        }
+    }
+    while (!mHasPending && mLocalIter.hasNext()) {
+        mPending = mLocalIter.next();
+        uint32_t index;
+        // The container has its own key order, skip the keys of the entries before mIndex.
+        mHasPending = node.isArray() || !node.findEntry(mPending.first.toString(), index) || index >= mIndex;
+    }
+    return true;
+}
+
+/// ================ GAnyDocumentChildren ================
+
+GAny GAnyDocumentChildren::find(uint32_t index) const
+{
+    GLockerGuard locker(mLock);
+    auto pinned = mPinned.find(index);
+    if (pinned != mPinned.end()) {
+        return pinned->second;
+    }
+    auto it = mWeak.find(index);
+    if (it != mWeak.end()) {
+        if (auto v = it->second.lock()) {
+            return GAny(std::move(v));
+        }
+    }
+    return GAny::undefined();
+}
+
+void GAnyDocumentChildren::insert(uint32_t index, const GAny &node)
+{
+    GLockerGuard locker(mLock);
+    if (mWeak.size() >= mPruneAt) {
+        for (auto it = mWeak.begin(); it != mWeak.end();) {
+            it = it->second.expired() ? mWeak.erase(it) : std::next(it);
+        }
+        mPruneAt = std::max<size_t>(64, mWeak.size() * 2);
+    }
+    mWeak[index] = node.value();
+}
+
+void GAnyDocumentChildren::pinSelf()
+{
+    auto parent = mParent.lock();
+    if (parent && parent->pin(mIndexInParent)) {
+        parent->pinSelf();
+    }
+}
+
+bool GAnyDocumentChildren::pin(uint32_t index)
+{
+    GLockerGuard locker(mLock);
+    if (mPinned.find(index) != mPinned.end()) {
+        return false;
+    }
+    auto it = mWeak.find(index);
+    if (it == mWeak.end()) {
+        return false;
+    }
+    auto v = it->second.lock();
+    if (!v) {
+        return false;
+    }
+    mPinned.emplace(index, GAny(std::move(v)));
+    return true;
+}
+
+/// ================ GAnyDocument ================
+
+static GAny loadDocument(const std::shared_ptr<const GAnyDocumentStorage> &storage)
+{
+    if (!storage || !storage->contains(0, sizeof(DocHeader))) {
+        return GAny::undefined();
+    }
+    const auto header = storage->read<DocHeader>(0);
+    if (memcmp(header.magic, GANY_DOC_MAGIC, sizeof(header.magic)) != 0
+        || header.version != GANY_DOC_VERSION
+        || header.size > storage->size()) {
+        return GAny::undefined();
+    }
+    return GAnyDocumentNode::decode(storage, header.root, false);
+}
+
+std::string GAnyDocument::encode(const GAny &value)
+{
+    GAnyDocumentEncoder encoder;
+    return encoder.finish(value);
+}
+
+bool GAnyDocument::save(const GAny &value, const std::string &filePath)
+{
+    std::string buffer = encode(value);
+#if GX_PLATFORM_WINDOWS
+    std::ofstream ofs(GString(filePath).toUtf16().data(), std::ios::binary | std::ios::trunc);
+#else
+    std::ofstream ofs(filePath, std::ios::binary | std::ios::trunc);
+#endif
+    if (!ofs.is_open()) {
+        return false;
+    }
+    ofs.write(buffer.data(), (std::streamsize) buffer.size());
+    return ofs.good();
+}
+
+GAny GAnyDocument::decode(std::string buffer)
+{
+    return loadDocument(std::make_shared<GAnyDocumentStorage>(std::move(buffer)));
+}
+
+GAny GAnyDocument::load(const std::string &filePath)
+{
+    return loadDocument(GAnyDocumentStorage::mapFile(filePath));
+}
+
+/// ================ Reflection ================
+
+void refGAnyDocument()
+{
+    GAnyClass::Class < GAnyDocumentNode > ()
+            ->setName("GAnyDocumentNode")
+            .setDoc("Lazy array/object node of a GAnyDocument.")
+            .func(MetaFunction::GetItem, [](const GAnyDocumentNode &self, const GAny &i) {
+                return self.getItem(i);
+            })
+            .func(MetaFunction::SetItem, [](GAnyDocumentNode &self, const GAny &i, const GAny &v) {
+                self.setItem(i, v);
+            })
+            .func(MetaFunction::DelItem, [](GAnyDocumentNode &self, const GAny &i) {
+                self.delItem(i);
+            })
+            .func(MetaFunction::Length, [](const GAnyDocumentNode &self) {
+                return (int64_t) self.length();
+            })
+            .func(MetaFunction::ToObject, [](const GAnyDocumentNode &self) {
+                return self.materialize(false);
+            })
+            .func(MetaFunction::ToString, [](const GAnyDocumentNode &self) {
+                return self.materialize(false).toJsonString();
+            })
+            .func("iterator", [](const GAny &self) {
+                return self.as<GAnyDocumentNode>().iterator(self);
+            });
+
+    GAnyClass::Class < GAnyDocumentIterator > ()
+            ->setName("GAnyDocumentIterator")
+            .setDoc("GAnyDocumentNode iterator.")
+            .func("hasNext", &GAnyDocumentIterator::hasNext)
+            .func("next", &GAnyDocumentIterator::next)
+            .func("toFront", &GAnyDocumentIterator::toFront);
+
+    auto DocumentClass = GAnyClass::Class("", "GAnyDocument", "Memory-mappable binary document of GAny trees.");
+    DocumentClass->staticFunc("encode", [](const GAny &value) {
+                return GAnyDocument::encode(value);
+            }, "Encode a GAny tree into a binary document.")
+            .staticFunc("save", &GAnyDocument::save, "Encode a GAny tree and write it to a file.")
+            .staticFunc("decode", [](const std::string &buffer) {
+                return GAnyDocument::decode(buffer);
+            }, "Load a document from a buffer.")
+            .staticFunc("load", &GAnyDocument::load, "Map a document file into memory.");
+    GAny::Export(DocumentClass);
+}
+
+GX_NS_END
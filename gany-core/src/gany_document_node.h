@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2022 Gxin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GX_GANY_DOCUMENT_NODE_H
+#define GX_GANY_DOCUMENT_NODE_H
+
+#include "gx/gany.h"
+
+#include <gx/gmutex.h>
+
+#include <atomic>
+
+
+GX_NS_BEGIN
+
+/**
+ * Binary layout, all values are stored in host byte order and every block is 8-byte aligned:
+ *  DocHeader   | magic, version, total size, root slot
+ *  String      | bytes + '\0', referenced by DocSlot::payload (offset) and DocSlot::length (byte count)
+ *  Array       | DocSlot[length]
+ *  Object      | DocEntry[length], sorted by key bytes
+ */
+enum class DocType : uint8_t
+{
+    Undefined = 0,
+    Null,
+    Boolean,
+    Int32,
+    UInt32,
+    Int64,
+    UInt64,
+    Float,
+    Double,
+    String,
+    Array,
+    Object,
+};
+
+struct DocSlot
+{
+    DocType type;
+    uint8_t reserved[3];
+    uint32_t length;
+    uint64_t payload;
+};
+
+struct DocEntry
+{
+    uint64_t keyOffset;
+    uint32_t keyLength;
+    uint32_t reserved;
+    DocSlot value;
+};
+
+struct DocHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t size;
+    DocSlot root;
+};
+
+static_assert(sizeof(DocSlot) == 16, "DocSlot must be 16 bytes.");
+static_assert(sizeof(DocEntry) == 32, "DocEntry must be 32 bytes.");
+static_assert(sizeof(DocHeader) == 32, "DocHeader must be 32 bytes.");
+
+
+/**
+ * @brief Backing memory of a document, either an owned buffer or a read-only file mapping.
+ */
+class GAnyDocumentStorage
+{
+public:
+    explicit GAnyDocumentStorage(std::string buffer);
+
+    ~GAnyDocumentStorage();
+
+    static std::shared_ptr<GAnyDocumentStorage> mapFile(const std::string &filePath);
+
+public:
+    const uint8_t *data() const
+    {
+        return mData;
+    }
+
+    size_t size() const
+    {
+        return mSize;
+    }
+
+    bool contains(uint64_t offset, uint64_t size) const
+    {
+        return offset <= mSize && size <= mSize - offset;
+    }
+
+    template<typename T>
+    T read(uint64_t offset) const
+    {
+        T v;
+        memcpy(&v, mData + offset, sizeof(T));
+        return v;
+    }
+
+private:
+    GAnyDocumentStorage() = default;
+
+private:
+    std::string mBuffer;
+    const uint8_t *mData = nullptr;
+    size_t mSize = 0;
+    void *mMapping = nullptr;
+    void *mFile = nullptr;
+};
+
+
+/**
+ * @brief Weak cache of the child containers handed out by a document node.
+ * A child is only kept while someone else holds it, so a single pass over a large document does not
+ * retain every decoded container. The first mutation of a child pins it (and its ancestors) so that the
+ * change stays visible through the parent.
+ */
+class GAnyDocumentChildren
+{
+public:
+    GAnyDocumentChildren(std::weak_ptr<GAnyDocumentChildren> parent, uint32_t indexInParent)
+            : mParent(std::move(parent)), mIndexInParent(indexInParent)
+    {}
+
+    /**
+     * @brief Get the cached child at index.
+     * @return The child, or undefined if it is not cached
+     */
+    GAny find(uint32_t index) const;
+
+    void insert(uint32_t index, const GAny &node);
+
+    /**
+     * @brief Hold the owner node strongly in its parent, and the parent in its own parent.
+     */
+    void pinSelf();
+
+private:
+    bool pin(uint32_t index);
+
+private:
+    std::weak_ptr<GAnyDocumentChildren> mParent;
+    uint32_t mIndexInParent;
+
+    mutable GSpinLock mLock;
+    std::unordered_map<uint32_t, std::weak_ptr<GAnyValue>> mWeak;
+    std::unordered_map<uint32_t, GAny> mPinned;
+    size_t mPruneAt = 64;
+};
+
+
+/**
+ * @brief Lazy view of an array or object inside a document.
+ * Reads decode directly from the storage, child containers are cached weakly (see GAnyDocumentChildren).
+ * The first mutation materializes the node into a shallow GAnyObject/GAnyArray (child containers stay lazy),
+ * all later operations, iteration included, are forwarded to it.
+ */
+class GAnyDocumentNode : public GAnyValue
+{
+public:
+    GAnyDocumentNode(std::shared_ptr<const GAnyDocumentStorage> storage, const DocSlot &slot,
+                     std::weak_ptr<GAnyDocumentChildren> parent = {}, uint32_t indexInParent = 0);
+
+public:
+    const void *as(const TypeID &tp) const override
+    {
+        if (GAnyTypeInfo::EqualType(tp, typeid(GAnyDocumentNode))) {
+            return this;
+        }
+        return nullptr;
+    }
+
+    GAnyClass *classObject() const override
+    {
+        static GAnyClass *clazz = nullptr;
+        return clazz ? clazz : clazz = GAnyClass::instance<GAnyDocumentNode>().get();
+    }
+
+    size_t length() const override;
+
+    GAny clone() const override;
+
+public:
+    bool isArray() const
+    {
+        return mSlot.type == DocType::Array;
+    }
+
+    GAny getItem(const GAny &i) const;
+
+    void setItem(const GAny &i, const GAny &v);
+
+    void delItem(const GAny &i);
+
+    /**
+     * @brief Decode this node into a GAnyObject/GAnyArray.
+     * @param deep  Whether child containers are decoded as well, otherwise they stay lazy
+     */
+    GAny materialize(bool deep) const;
+
+    GAny iterator(const GAny &self) const;
+
+    static GAny decode(const std::shared_ptr<const GAnyDocumentStorage> &storage, const DocSlot &slot, bool deep);
+
+private:
+    const GAny *local() const;
+
+    GAny child(uint32_t index, const DocSlot &slot, bool deep) const;
+
+    DocSlot slotAt(uint32_t index) const;
+
+    DocEntry entryAt(uint32_t index) const;
+
+    GAny &mutableLocal();
+
+    bool findEntry(const std::string &key, uint32_t &index) const;
+
+private:
+    friend class GAnyDocumentIterator;
+
+    std::shared_ptr<const GAnyDocumentStorage> mStorage;
+    DocSlot mSlot;
+
+    mutable GSpinLock mLock;
+    std::shared_ptr<GAnyDocumentChildren> mChildren;
+    std::atomic<bool> mMaterialized{false};
+    GAny mLocal;
+};
+
+
+class GAnyDocumentIterator
+{
+public:
+    explicit GAnyDocumentIterator(GAny node)
+            : mNode(std::move(node))
+    {}
+
+    bool hasNext() const;
+
+    GAnyIteratorItem next();
+
+    void toFront()
+    {
+        mIndex = 0;
+        mLocalIter = GAny::undefined();
+        mHasPending = false;
+    }
+
+private:
+    /**
+     * @brief Once the node has been mutated, continue on its materialized container and fetch the
+     * next item not returned yet into mPending.
+     * @return false while the node has not been mutated
+     */
+    bool syncLocal() const;
+
+private:
+    GAny mNode;
+    uint32_t mIndex = 0;
+    mutable GAny mLocalIter;
+    mutable GAnyIteratorItem mPending;
+    mutable bool mHasPending = false;
+};
+
+void refGAnyDocument();
+
+GX_NS_END
+
+#endif //GX_GANY_DOCUMENT_NODE_H
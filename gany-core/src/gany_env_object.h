@@ -26,10 +26,100 @@
 #include "gx/gany.h"
 
 #include <gx/gmutex.h>
+#include <gx/graii.h>
+
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <atomic>
 
 
 GX_NS_BEGIN
 
+/**
+ * Collects the top-level env names that classes are registered under on the current thread while it is alive.
+ * Recorders nest, a registration made inside an inner recorder (e.g. by a lazy loader) is only seen by that one.
+ */
+class GAnyEnvRegisterRecorder
+{
+public:
+    GAnyEnvRegisterRecorder()
+            : mPrevious(sCurrent)
+    {
+        sCurrent = this;
+    }
+
+    ~GAnyEnvRegisterRecorder()
+    {
+        sCurrent = mPrevious;
+    }
+
+    GAnyEnvRegisterRecorder(const GAnyEnvRegisterRecorder &) = delete;
+
+    GAnyEnvRegisterRecorder &operator=(const GAnyEnvRegisterRecorder &) = delete;
+
+    const std::vector<std::string> &names() const
+    {
+        return mNames;
+    }
+
+    static void record(const std::string &name)
+    {
+        if (sCurrent && std::find(sCurrent->mNames.begin(), sCurrent->mNames.end(), name) == sCurrent->mNames.end()) {
+            sCurrent->mNames.push_back(name);
+        }
+    }
+
+private:
+    static inline thread_local GAnyEnvRegisterRecorder *sCurrent = nullptr;
+
+    GAnyEnvRegisterRecorder *mPrevious;
+    std::vector<std::string> mNames;
+};
+
+/**
+ * Placeholder for an env entry that is registered on first lookup.
+ * One stub may stand for several names, its loader runs exactly once.
+ */
+class GAnyLazyEnvStub
+{
+public:
+    explicit GAnyLazyEnvStub(GAny loader)
+            : mLoader(std::move(loader))
+    {}
+
+    /**
+     * Run the loader unless it already ran. Concurrent callers wait for the running loader.
+     * @return false when called again from inside the loader itself
+     */
+    bool load()
+    {
+        if (mLoadingThread.load(std::memory_order_acquire) == std::this_thread::get_id()) {
+            return false;
+        }
+        std::call_once(mOnce, [this]() {
+            mLoadingThread.store(std::this_thread::get_id(), std::memory_order_release);
+            GRaii loadingGuard([this]() {
+                mLoadingThread.store(std::thread::id(), std::memory_order_release);
+            });
+            // Whatever the loader registers belongs to it, not to a plugin registration that triggered it.
+            GAnyEnvRegisterRecorder recorder;
+            try {
+                mLoader();
+            } catch (const std::exception &e) {
+                std::cerr << "Lazy env loader failed: " << e.what() << std::endl;
+            }
+            mLoader = GAny();
+        });
+        return true;
+    }
+
+private:
+    std::once_flag mOnce;
+    std::atomic<std::thread::id> mLoadingThread{};
+    GAny mLoader;
+};
+
 class GAnyEnvObject : public GAnyValueP<std::unordered_map<std::string, GAny> >
 {
 public:
@@ -44,6 +134,9 @@ public:
         if (GAnyTypeInfo::EqualType(tp, typeid(GAnyEnvObject))) {
             return this;
         }
+        if (GAnyTypeInfo::EqualType(tp, typeid(GAnyEnvVersion))) {
+            return &version();
+        }
         return nullptr;
     }
 
@@ -55,7 +148,26 @@ public:
 
     GAny get(const std::string &key)
     {
-        GLockerGuard locker(lock);
+        std::shared_ptr<GAnyLazyEnvStub> stub;
+        {
+            std::shared_lock locker(lock);
+            auto it = var.find(key);
+            if (it != var.end()) {
+                return it->second;
+            }
+            auto sIt = lazyStubs.find(key);
+            if (sIt == lazyStubs.end()) {
+                return GAny::undefined();
+            }
+            stub = sIt->second;
+        }
+        if (!stub->load()) {
+            return GAny::undefined();
+        }
+        std::unique_lock locker(lock);
+        if (lazyStubs.erase(key) > 0) {
+            changed();
+        }
         auto it = var.find(key);
         if (it == var.end()) {
             return GAny::undefined();
@@ -63,34 +175,128 @@ public:
         return it->second;
     }
 
+    /**
+     * Register names as lazy: the first get of any of them runs stub's loader, which is expected to set them.
+     * All or nothing, a name that is already set or lazy would hide the loader's content behind the existing entry.
+     * @return Whether the stub was installed
+     */
+    bool setLazy(const std::vector<std::string> &keys, const std::shared_ptr<GAnyLazyEnvStub> &stub)
+    {
+        std::unique_lock locker(lock);
+        for (const auto &key: keys) {
+            if (var.find(key) != var.end() || lazyStubs.find(key) != lazyStubs.end()) {
+                return false;
+            }
+        }
+        for (const auto &key: keys) {
+            lazyStubs[key] = stub;
+        }
+        changed();
+        return true;
+    }
+
+    bool setLazy(const std::string &key, const std::shared_ptr<GAnyLazyEnvStub> &stub)
+    {
+        return setLazy(std::vector<std::string>{key}, stub);
+    }
+
+    bool isLazy(const std::string &key) const
+    {
+        std::shared_lock locker(lock);
+        return lazyStubs.find(key) != lazyStubs.end();
+    }
+
     void set(const std::string &key, const GAny &value)
     {
-        GLockerGuard locker(lock);
+        std::unique_lock locker(lock);
+        lazyStubs.erase(key);
         auto it = var.find(key);
         if (it == var.end()) {
             var.insert(std::make_pair(key, value));
         } else {
             it->second = value;
         }
+        changed();
+    }
+
+    /**
+     * Return the value of key, setting it to create() first if it is missing. Runs under one lock, so concurrent
+     * callers creating the same key all get the same value.
+     */
+    template<typename Create>
+    GAny getOrCreate(const std::string &key, Create &&create)
+    {
+        {
+            std::shared_lock locker(lock);
+            auto it = var.find(key);
+            if (it != var.end()) {
+                return it->second;
+            }
+        }
+        std::unique_lock locker(lock);
+        auto it = var.find(key);
+        if (it != var.end()) {
+            return it->second;
+        }
+        lazyStubs.erase(key);
+        GAny value = create();
+        var.emplace(key, value);
+        changed();
+        return value;
+    }
+
+    /**
+     * Set key to value unless it is already set.
+     * @return Whether value was set
+     */
+    bool setIfAbsent(const std::string &key, const GAny &value)
+    {
+        std::unique_lock locker(lock);
+        if (var.find(key) != var.end()) {
+            return false;
+        }
+        lazyStubs.erase(key);
+        var.emplace(key, value);
+        changed();
+        return true;
     }
 
     void erase(const std::string &key)
     {
-        GLockerGuard locker(lock);
+        std::unique_lock locker(lock);
         auto it = var.find(key);
         if (it != var.end()) {
             var.erase(it);
         }
+        lazyStubs.erase(key);
+        changed();
     }
 
     bool contains(const std::string &key) const
     {
-        GLockerGuard locker(lock);
+        std::shared_lock locker(lock);
         return var.find(key) != var.end();
     }
 
+    /**
+     * Change counter shared by the root env and all namespace objects, GAny::Import caches are keyed on it.
+     */
+    static GAnyEnvVersion &version()
+    {
+        static GAnyEnvVersion sVersion;
+        return sVersion;
+    }
+
+private:
+    static void changed()
+    {
+        version().value.fetch_add(1, std::memory_order_release);
+    }
+
 public:
-    mutable GMutex lock;
+    /// Lookups vastly outnumber registrations, readers share the lock.
+    mutable std::shared_mutex lock;
+    std::unordered_map<std::string, std::shared_ptr<GAnyLazyEnvStub>> lazyStubs;
 };
 
 extern GAny &getEnv();
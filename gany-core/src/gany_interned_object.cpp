@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2022 Gxin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gany_interned_object.h"
+#include "gany_json_builder.h"
+
+#include "gx/gany_json.h"
+
+
+GX_NS_BEGIN
+
+/// ================ GAnyKeyTable ================
+
+const std::string *GAnyKeyTable::intern(std::string_view key)
+{
+    GLockerGuard locker(mLock);
+    auto it = mIndex.find(key);
+    if (it != mIndex.end()) {
+        return it->second;
+    }
+    // Deque elements never move, so the view and the pointer stay valid for the lifetime of the table.
+    const std::string &stored = mStorage.emplace_back(key);
+    mIndex.emplace(std::string_view(stored), &stored);
+    return &stored;
+}
+
+const std::string *GAnyKeyTable::find(std::string_view key) const
+{
+    GLockerGuard locker(mLock);
+    auto it = mIndex.find(key);
+    return it != mIndex.end() ? it->second : nullptr;
+}
+
+/// ================ GAnyInternedObject ================
+
+size_t GAnyInternedObject::length() const
+{
+    GLockerGuard locker(mLock);
+    return mItems.size();
+}
+
+GAny GAnyInternedObject::clone() const
+{
+    auto copy = std::make_shared<GAnyInternedObject>(mKeys);
+    GLockerGuard locker(mLock);
+    copy->mItems.reserve(mItems.size());
+    for (const auto &item: mItems) {
+        copy->mItems.emplace_back(item.first, item.second.clone());
+    }
+    return GAny((std::shared_ptr<GAnyValue>) copy);
+}
+
+void GAnyInternedObject::append(const std::string *key, GAny v)
+{
+    for (auto &item: mItems) {
+        if (item.first == key) {
+            item.second = std::move(v);
+            return;
+        }
+    }
+    mItems.emplace_back(key, std::move(v));
+}
+
+GAny GAnyInternedObject::getItem(const GAny &i) const
+{
+    if (!i.isString()) {
+        return GAny::undefined();
+    }
+    const std::string *key = mKeys->find(i.unsafeAs<std::string>());
+    if (!key) {
+        return GAny::undefined();
+    }
+    GLockerGuard locker(mLock);
+    for (const auto &item: mItems) {
+        if (item.first == key) {
+            return item.second;
+        }
+    }
+    return GAny::undefined();
+}
+
+void GAnyInternedObject::setItem(const GAny &i, const GAny &v)
+{
+    if (!i.isString()) {
+        return;
+    }
+    const std::string *key = mKeys->intern(i.unsafeAs<std::string>());
+    GLockerGuard locker(mLock);
+    append(key, v);
+}
+
+void GAnyInternedObject::delItem(const GAny &i)
+{
+    if (!i.isString()) {
+        return;
+    }
+    const std::string *key = mKeys->find(i.unsafeAs<std::string>());
+    if (!key) {
+        return;
+    }
+    GLockerGuard locker(mLock);
+    for (auto it = mItems.begin(); it != mItems.end(); ++it) {
+        if (it->first == key) {
+            mItems.erase(it);
+            return;
+        }
+    }
+}
+
+GAny GAnyInternedObject::toObject() const
+{
+    std::unordered_map<std::string, GAny> map;
+    GLockerGuard locker(mLock);
+    map.reserve(mItems.size());
+    for (const auto &item: mItems) {
+        map.emplace(*item.first, item.second);
+    }
+    return (std::shared_ptr<GAnyValue>) std::make_shared<GAnyObject>(std::move(map));
+}
+
+/// ================ GAnyInternedObjectIterator ================
+
+bool GAnyInternedObjectIterator::hasNext() const
+{
+    const auto &obj = mObject.as<GAnyInternedObject>();
+    GLockerGuard locker(obj.mLock);
+    return mIndex < obj.mItems.size();
+}
+
+GAnyIteratorItem GAnyInternedObjectIterator::next()
+{
+    const auto &obj = mObject.as<GAnyInternedObject>();
+    GLockerGuard locker(obj.mLock);
+    if (mIndex >= obj.mItems.size()) {
+        return std::make_pair(nullptr, nullptr);
+    }
+    const auto &item = obj.mItems[mIndex++];
+    return std::make_pair(*item.first, item.second);
+}
+
+/// ================ GAnyJson ================
+
+GAny GAnyJson::parseInterned(const std::string &json, bool rawNumbers)
+{
+    using namespace rapidjson;
+
+    GAnyJsonBuilder builder(std::make_shared<GAnyKeyTable>());
+    Reader reader;
+    StringStream ss(json.c_str());
+    const ParseResult result = rawNumbers
+                               ? reader.Parse<kParseNumbersAsStringsFlag>(ss, builder)
+                               : reader.Parse(ss, builder);
+    if (!result.IsError()) {
+        return std::move(builder.result());
+    }
+    return GAny::object();
+}
+
+void refGAnyInternedObject()
+{
+    GAnyClass::Class < GAnyInternedObject > ()
+            ->setName("GAnyInternedObject")
+            .setDoc("Object with interned keys, built by GAnyJson.parseInterned.")
+            .func(MetaFunction::GetItem, [](const GAnyInternedObject &self, const GAny &i) {
+                return self.getItem(i);
+            })
+            .func(MetaFunction::SetItem, [](GAnyInternedObject &self, const GAny &i, const GAny &v) {
+                self.setItem(i, v);
+            })
+            .func(MetaFunction::DelItem, [](GAnyInternedObject &self, const GAny &i) {
+                self.delItem(i);
+            })
+            .func(MetaFunction::Length, [](const GAnyInternedObject &self) {
+                return (int64_t) self.length();
+            })
+            .func(MetaFunction::ToObject, [](const GAnyInternedObject &self) {
+                return self.toObject();
+            })
+            .func(MetaFunction::ToString, [](const GAnyInternedObject &self) {
+                return self.toObject().toJsonString();
+            })
+            .func("iterator", [](const GAny &self) {
+                return GAny(std::make_unique<GAnyInternedObjectIterator>(self));
+            });
+
+    GAnyClass::Class < GAnyInternedObjectIterator > ()
+            ->setName("GAnyInternedObjectIterator")
+            .setDoc("GAnyInternedObject iterator.")
+            .func("hasNext", &GAnyInternedObjectIterator::hasNext)
+            .func("next", &GAnyInternedObjectIterator::next)
+            .func("toFront", &GAnyInternedObjectIterator::toFront);
+
+    auto JsonClass = GAnyClass::Class("", "GAnyJson", "JSON parsing options beyond GAny.parseJson.");
+    JsonClass->staticFunc("parseInterned", [](const std::string &json, bool rawNumbers) {
+        return GAnyJson::parseInterned(json, rawNumbers);
+    }, "Parse JSON with interned object keys.");
+    GAny::Export(JsonClass);
+}
+
+GX_NS_END
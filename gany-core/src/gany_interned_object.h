@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2022 Gxin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GX_GANY_INTERNED_OBJECT_H
+#define GX_GANY_INTERNED_OBJECT_H
+
+#include "gx/gany.h"
+
+#include <gx/gmutex.h>
+
+#include <deque>
+#include <string_view>
+
+
+GX_NS_BEGIN
+
+/**
+ * @brief Interned object keys shared by the objects of one parse.
+ * Each distinct key is stored once and never moves, so objects keep a pointer to it and compare keys by address.
+ */
+class GAnyKeyTable
+{
+public:
+    /**
+     * @brief Get the interned storage of key, adding it on first use.
+     */
+    const std::string *intern(std::string_view key);
+
+    /**
+     * @brief Get the interned storage of key.
+     * @return nullptr if no object of this table has ever used the key
+     */
+    const std::string *find(std::string_view key) const;
+
+private:
+    mutable GSpinLock mLock;
+    std::deque<std::string> mStorage;
+    std::unordered_map<std::string_view, const std::string *> mIndex;
+};
+
+
+/**
+ * @brief Object with interned keys, built by GAnyJson::parseInterned.
+ * Members are kept in insertion order as (key, value) pairs, a lookup interns the requested key once
+ * and then only compares addresses.
+ */
+class GAnyInternedObject : public GAnyValue
+{
+public:
+    explicit GAnyInternedObject(std::shared_ptr<GAnyKeyTable> keys)
+            : mKeys(std::move(keys))
+    {}
+
+public:
+    const void *as(const TypeID &tp) const override
+    {
+        if (GAnyTypeInfo::EqualType(tp, typeid(GAnyInternedObject))) {
+            return this;
+        }
+        return nullptr;
+    }
+
+    GAnyClass *classObject() const override
+    {
+        static GAnyClass *clazz = nullptr;
+        return clazz ? clazz : clazz = GAnyClass::instance<GAnyInternedObject>().get();
+    }
+
+    size_t length() const override;
+
+    GAny clone() const override;
+
+public:
+    /**
+     * @brief Parser side insertion, the object is not shared yet so no lock is taken.
+     */
+    void append(const std::string *key, GAny v);
+
+    void reserve(size_t n)
+    {
+        mItems.reserve(n);
+    }
+
+    const std::shared_ptr<GAnyKeyTable> &keys() const
+    {
+        return mKeys;
+    }
+
+    GAny getItem(const GAny &i) const;
+
+    void setItem(const GAny &i, const GAny &v);
+
+    void delItem(const GAny &i);
+
+    /**
+     * @brief Copy the members into a GAnyObject, values are shared.
+     */
+    GAny toObject() const;
+
+private:
+    friend class GAnyInternedObjectIterator;
+
+    std::shared_ptr<GAnyKeyTable> mKeys;
+
+    mutable GSpinLock mLock;
+    std::vector<std::pair<const std::string *, GAny>> mItems;
+};
+
+
+class GAnyInternedObjectIterator
+{
+public:
+    explicit GAnyInternedObjectIterator(GAny object)
+            : mObject(std::move(object))
+    {}
+
+    bool hasNext() const;
+
+    GAnyIteratorItem next();
+
+    void toFront()
+    {
+        mIndex = 0;
+    }
+
+private:
+    GAny mObject;
+    size_t mIndex = 0;
+};
+
+void refGAnyInternedObject();
+
+GX_NS_END
+
+#endif //GX_GANY_INTERNED_OBJECT_H
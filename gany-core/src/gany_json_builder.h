@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) 2022 Gxin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GX_GANY_JSON_BUILDER_H
+#define GX_GANY_JSON_BUILDER_H
+
+#include "gx/gany.h"
+
+#include "gany_interned_object.h"
+
+#ifdef GetObject
+    #undef GetObject
+#endif
+
+#include <rapidjson/reader.h>
+
+#include <limits>
+
+
+GX_NS_BEGIN
+
+/**
+ * @brief rapidjson SAX handler that builds a GAny tree directly, without an intermediate Document.
+ * Integers are narrowed the same way rapidjson::Value reports them (int, uint, int64, uint64),
+ * and objects are pre-sized from the member count of the previous object at the same depth,
+ * so arrays of records do not rehash for every element.
+ * With kParseNumbersAsStringsFlag numbers are kept as GAnyNumber.
+ * Given a key table, objects are built as GAnyInternedObject and every key is interned in that table.
+ */
+class GAnyJsonBuilder : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, GAnyJsonBuilder>
+{
+public:
+    explicit GAnyJsonBuilder(std::shared_ptr<GAnyKeyTable> keys = nullptr)
+            : mKeys(std::move(keys))
+    {}
+
+public:
+    bool Null()
+    {
+        return add(GAny::null());
+    }
+
+    bool Bool(bool b)
+    {
+        return add(b);
+    }
+
+    bool Int(int i)
+    {
+        return add(i);
+    }
+
+    bool Uint(unsigned u)
+    {
+        if (u <= (unsigned) std::numeric_limits<int32_t>::max()) {
+            return add((int32_t) u);
+        }
+        return add(u);
+    }
+
+    bool Int64(int64_t i)
+    {
+        if (i >= std::numeric_limits<int32_t>::min() && i <= std::numeric_limits<int32_t>::max()) {
+            return add((int32_t) i);
+        }
+        return add(i);
+    }
+
+    bool Uint64(uint64_t u)
+    {
+        if (u <= (uint64_t) std::numeric_limits<int64_t>::max()) {
+            return Int64((int64_t) u);
+        }
+        return add(u);
+    }
+
+    bool Double(double d)
+    {
+        return add(d);
+    }
+
+    bool RawNumber(const char *str, rapidjson::SizeType length, bool)
+    {
+        return add(GAnyNumber(std::string(str, length)));
+    }
+
+    bool String(const char *str, rapidjson::SizeType length, bool)
+    {
+        return add(std::string(str, length));
+    }
+
+    bool StartObject()
+    {
+        Frame frame;
+        const size_t depth = mStack.size();
+        const size_t hint = depth < mSizeHints.size() ? mSizeHints[depth] : 0;
+        if (mKeys) {
+            auto interned = std::make_shared<GAnyInternedObject>(mKeys);
+            interned->reserve(hint);
+            frame.interned = interned.get();
+            frame.value = GAny((std::shared_ptr<GAnyValue>) interned);
+        } else {
+            frame.value = GAny::object();
+            frame.object = &frame.value.unsafeAs<std::unordered_map<std::string, GAny>>();
+            if (hint > 0) {
+                frame.object->reserve(hint);
+            }
+        }
+        mStack.push_back(std::move(frame));
+        return true;
+    }
+
+    bool Key(const char *str, rapidjson::SizeType length, bool)
+    {
+        if (mKeys) {
+            mStack.back().internedKey = mKeys->intern(std::string_view(str, length));
+            return true;
+        }
+        // The pending key buffer keeps its capacity, only the map node allocates.
+        mStack.back().key.assign(str, length);
+        return true;
+    }
+
+    bool EndObject(rapidjson::SizeType memberCount)
+    {
+        const size_t depth = mStack.size() - 1;
+        if (depth >= mSizeHints.size()) {
+            mSizeHints.resize(depth + 1, 0);
+        }
+        mSizeHints[depth] = memberCount;
+        return pop();
+    }
+
+    bool StartArray()
+    {
+        Frame frame;
+        frame.value = GAny::array();
+        frame.array = &frame.value.unsafeAs<std::vector<GAny>>();
+        mStack.push_back(std::move(frame));
+        return true;
+    }
+
+    bool EndArray(rapidjson::SizeType)
+    {
+        return pop();
+    }
+
+    GAny &result()
+    {
+        return mResult;
+    }
+
+private:
+    struct Frame
+    {
+        GAny value;
+        std::unordered_map<std::string, GAny> *object = nullptr;
+        std::vector<GAny> *array = nullptr;
+        GAnyInternedObject *interned = nullptr;
+        std::string key;
+        const std::string *internedKey = nullptr;
+    };
+
+    bool add(GAny v)
+    {
+        if (mStack.empty()) {
+            mResult = std::move(v);
+            return true;
+        }
+        // Containers under construction are not shared yet, so their locks are not taken.
+        Frame &top = mStack.back();
+        if (top.array) {
+            top.array->push_back(std::move(v));
+        } else if (top.interned) {
+            top.interned->append(top.internedKey, std::move(v));
+        } else {
+            (*top.object)[top.key] = std::move(v);
+        }
+        return true;
+    }
+
+    bool pop()
+    {
+        GAny v = std::move(mStack.back().value);
+        mStack.pop_back();
+        return add(std::move(v));
+    }
+
+private:
+    std::shared_ptr<GAnyKeyTable> mKeys;
+    std::vector<Frame> mStack;
+    std::vector<size_t> mSizeHints;
+    GAny mResult;
+};
+
+
+/**
+ * @brief Emit SAX events of a GAny tree to a rapidjson handler, values are mapped the same way as dumpJson.
+ */
+template<typename Handler>
+bool ganyToSax(const GAny &v, Handler &handler)
+{
+    switch (v.type()) {
+        case AnyType::undefined_t:
+        case AnyType::null_t:
+            return handler.Null();
+        case AnyType::boolean_t:
+            return handler.Bool(v.toBool());
+        case AnyType::int8_t:
+        case AnyType::int16_t:
+        case AnyType::int32_t: {
+            if (v.is<uint8_t>() || v.is<uint16_t>() || v.is<uint32_t>()) {
+                return handler.Uint((unsigned) v.toInt64());
+            }
+            return handler.Int(v.toInt32());
+        }
+        case AnyType::int64_t: {
+            if (v.is<uint64_t>()) {
+                return handler.Uint64(v.as<uint64_t>());
+            }
+            return handler.Int64(v.toInt64());
+        }
+        case AnyType::float_t:
+        case AnyType::double_t:
+            return handler.Double(v.toDouble());
+        case AnyType::string_t: {
+            const auto &str = v.as<std::string>();
+            return handler.String(str.data(), (rapidjson::SizeType) str.size(), true);
+        }
+        case AnyType::array_t: {
+            const auto &vec = v.unsafeAs<std::vector<GAny>>();
+            if (!handler.StartArray()) {
+                return false;
+            }
+            rapidjson::SizeType count = 0;
+            for (const auto &item: vec) {
+                if (item.isUndefined()) {
+                    continue;
+                }
+                if (!ganyToSax(item, handler)) {
+                    return false;
+                }
+                count++;
+            }
+            return handler.EndArray(count);
+        }
+        case AnyType::object_t: {
+            const auto &obj = v.unsafeAs<std::unordered_map<std::string, GAny>>();
+            if (!handler.StartObject()) {
+                return false;
+            }
+            rapidjson::SizeType count = 0;
+            for (const auto &item: obj) {
+                if (item.second.isUndefined()) {
+                    continue;
+                }
+                if (!handler.Key(item.first.data(), (rapidjson::SizeType) item.first.size(), true)
+                    || !ganyToSax(item.second, handler)) {
+                    return false;
+                }
+                count++;
+            }
+            return handler.EndObject(count);
+        }
+        default:
+            break;
+    }
+
+    if (v.is<GAnyNumber>()) {
+        const auto &num = v.as<GAnyNumber>();
+        if (num.isInteger() && num.text()[0] != '-' && num.toInt64() < 0) {
+            return handler.Uint64((uint64_t) num.toInt64());
+        }
+        return num.isInteger() ? handler.Int64(num.toInt64()) : handler.Double(num.toDouble());
+    }
+    if (v.type() == AnyType::user_obj_t && v.classObject().containsMember(MetaFunction::ToObject)) {
+        return ganyToSax(v.toObject(), handler);
+    }
+    std::string str;
+    try {
+        str = v.toString();
+    } catch (GAnyException &) {
+        return false;
+    }
+    return handler.String(str.data(), (rapidjson::SizeType) str.size(), true);
+}
+
+GX_NS_END
+
+#endif //GX_GANY_JSON_BUILDER_H
@@ -23,13 +23,10 @@
 #include "gany_pfn_impl.h"
 
 #include "gany_env_object.h"
-#include "gx/sstring.h"
+#include "gany_json_builder.h"
 
-#ifdef GetObject
-    #undef GetObject
-#endif
-
-#include <rapidjson/document.h>
+#include <shared_mutex>
+#include <string_view>
 
 
 GX_NS_BEGIN
@@ -50,70 +47,20 @@ void *GX_API_CALL ganyGetEnvImpl()
     return &getEnv();
 }
 
-static GAny _parseJson(const rapidjson::Value &v)
-{
-    using namespace rapidjson;
-
-    switch (v.GetType()) {
-        case rapidjson::kNullType:
-            return GAny::null();
-        case rapidjson::kFalseType:
-            return false;
-        case rapidjson::kTrueType:
-            return true;
-        case rapidjson::kObjectType: {
-            GAny obj = GAny::object();
-            for (auto &i: v.GetObject()) {
-                obj[std::string(i.name.GetString())] = _parseJson(i.value);
-            }
-            return obj;
-        }
-        case rapidjson::kArrayType: {
-            GAny array = GAny::array();
-            for (const Value &i: v.GetArray()) {
-                array.pushBack(_parseJson(i));
-            }
-            return array;
-        }
-        case rapidjson::kStringType: {
-            auto s = std::string(v.GetString());
-            return s;
-        }
-        case rapidjson::kNumberType: {
-            if (v.IsInt()) {
-                return v.GetInt();
-            }
-            if (v.IsUint()) {
-                return v.GetUint();
-            }
-            if (v.IsInt64()) {
-                return v.GetInt64();
-            }
-            if (v.IsUint64()) {
-                return v.GetUint64();
-            }
-            if (v.IsDouble()) {
-                return v.GetDouble();
-            }
-            if (v.IsFloat()) {
-                return v.GetFloat();
-            }
-        }
-            break;
-    }
-    return GAny::object();
-}
-
-
-void GX_API_CALL ganyParseJsonImpl(const char *jsonStr, void *ret)
+void GX_API_CALL ganyParseJsonImpl(const char *jsonStr, bool rawNumbers, void *ret)
 {
     using namespace rapidjson;
 
-    Document doc;
-
     GAny &retObj = *reinterpret_cast<GAny *>(ret);
-    if (!doc.Parse(jsonStr).HasParseError()) {
-        retObj = _parseJson(doc);
+
+    GAnyJsonBuilder builder;
+    Reader reader;
+    StringStream ss(jsonStr);
+    const ParseResult result = rawNumbers
+                               ? reader.Parse<kParseNumbersAsStringsFlag>(ss, builder)
+                               : reader.Parse(ss, builder);
+    if (!result.IsError()) {
+        retObj = std::move(builder.result());
         return;
     }
     retObj = GAny::object();
@@ -130,50 +77,59 @@ void GX_API_CALL ganyRegisterToEnvImpl(void *v)
         return;
     }
     auto &env = getEnvObject();
+    // Let a pending lazy entry of the same name register its content first, so neither side is lost.
+    const auto &topName = clazz.getNameSpace().empty() ? clazz.getName() : clazz.getNameSpace();
+    GAnyEnvRegisterRecorder::record(topName);
+    if (env.isLazy(topName)) {
+        env.get(topName);
+    }
+    // Loaders may register into the same namespace from several threads, each step is a single locked check-and-set.
     if (clazz.getNameSpace().empty()) {
-        if (!env.contains(clazz.getName())) {
-            env.set(clazz.getName(), classObj);
-        }
+        env.setIfAbsent(clazz.getName(), classObj);
     } else {
-        if (!env.contains(clazz.getNameSpace())) {
-            env.set(clazz.getNameSpace(), std::make_shared<GAnyEnvObject>());
-        }
-        auto &ns = env.get(clazz.getNameSpace()).as<GAnyEnvObject>();
-        if (!ns.contains(clazz.getName())) {
-            ns.set(clazz.getName(), classObj);
-        }
+        GAny nsObj = env.getOrCreate(clazz.getNameSpace(), []() {
+            return GAny(std::make_shared<GAnyEnvObject>());
+        });
+        nsObj.as<GAnyEnvObject>().setIfAbsent(clazz.getName(), classObj);
     }
 }
 
 void GX_API_CALL ganyClassInstanceImpl(void *typeInfo, void *ret)
 {
-    static GSpinLock lock;
-    static std::unordered_map<StaticString, std::shared_ptr<GAnyClass>> clsMap;
+    // Only reached once per type and module, GAnyClass::instance<T> caches the result on the caller side.
+    static std::shared_mutex lock;
+    static std::unordered_map<std::string_view, std::shared_ptr<GAnyClass>> clsMap;
     static std::array<std::shared_ptr<GAnyClass>, 25> basicTypeArray;
 
     auto *typeInfoPtr = reinterpret_cast<GAnyTypeInfo *>(typeInfo);
     std::shared_ptr<GAnyClass> &cls = *reinterpret_cast<std::shared_ptr<GAnyClass> *>(ret);
 
-    if (typeInfoPtr->basicTypeIndex() >= 0) {
-        auto &basicTypeRef = basicTypeArray[typeInfoPtr->basicTypeIndex()];
-        if (!basicTypeRef) {
-            basicTypeRef = std::shared_ptr<GAnyClass>(
-                    GX_NEW(GAnyClass, "", typeInfoPtr->demangleName(), "", *typeInfoPtr));
+    const int32_t basicTypeIndex = typeInfoPtr->basicTypeIndex();
+    const std::string_view className = typeInfoPtr->name();
+    {
+        std::shared_lock locker(lock);
+        if (basicTypeIndex >= 0) {
+            cls = basicTypeArray[basicTypeIndex];
+        } else {
+            auto it = clsMap.find(className);
+            if (it != clsMap.end()) {
+                cls = it->second;
+            }
+        }
+        if (cls) {
+            return;
         }
-        cls = basicTypeRef;
-        return;
     }
 
-    StaticString className = typeInfoPtr->name();
+    // Demangle outside the lock, a concurrent creator of the same type wins below.
+    auto newCls = std::shared_ptr<GAnyClass>(GX_NEW(GAnyClass, "", typeInfoPtr->demangleName(), "", *typeInfoPtr));
 
-    std::lock_guard locker(lock);
-    auto it = clsMap.find(className);
-    if (it != clsMap.end()) {
-        cls = it->second;
-        return;
+    std::unique_lock locker(lock);
+    auto &slot = basicTypeIndex >= 0 ? basicTypeArray[basicTypeIndex] : clsMap[className];
+    if (!slot) {
+        slot = std::move(newCls);
     }
-    cls = std::shared_ptr<GAnyClass>(GX_NEW(GAnyClass, "", typeInfoPtr->demangleName(), "", *typeInfoPtr));
-    clsMap.emplace(className, cls);
+    cls = slot;
 }
 
 GX_NS_END
\ No newline at end of file
@@ -30,7 +30,7 @@ GX_NS_BEGIN
 
 void *GX_API_CALL ganyGetEnvImpl();
 
-void GX_API_CALL ganyParseJsonImpl(const char *jsonStr, void *ret);
+void GX_API_CALL ganyParseJsonImpl(const char *jsonStr, bool rawNumbers, void *ret);
 
 void GX_API_CALL ganyRegisterToEnvImpl(void *clazz);
 
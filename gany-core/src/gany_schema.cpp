@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2022 Gxin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gx/gany_schema.h"
+
+#include "gany_json_builder.h"
+#include "ref_gany_schema.h"
+
+#include <rapidjson/document.h>
+#include <rapidjson/schema.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/error/en.h>
+
+
+GX_NS_BEGIN
+
+class GAnySchemaImpl
+{
+public:
+    explicit GAnySchemaImpl(rapidjson::Document &&doc)
+            : source(std::move(doc)), schema(source)
+    {}
+
+public:
+    rapidjson::Document source;
+    rapidjson::SchemaDocument schema;
+};
+
+
+static void setError(std::string *error, std::string msg)
+{
+    if (error) {
+        *error = std::move(msg);
+    }
+}
+
+template<typename Validator>
+static std::string validationError(const Validator &validator)
+{
+    rapidjson::StringBuffer docPtr;
+    rapidjson::StringBuffer schemaPtr;
+    validator.GetInvalidDocumentPointer().StringifyUriFragment(docPtr);
+    validator.GetInvalidSchemaPointer().StringifyUriFragment(schemaPtr);
+    const char *keyword = validator.GetInvalidSchemaKeyword();
+
+    std::stringstream ss;
+    ss << "Schema validation failed at '" << docPtr.GetString()
+       << "', keyword '" << (keyword ? keyword : "") << "' of schema '" << schemaPtr.GetString() << "'";
+    return ss.str();
+}
+
+static std::string parseError(const rapidjson::ParseResult &result)
+{
+    std::stringstream ss;
+    ss << "JSON parse error at offset " << result.Offset() << ": " << rapidjson::GetParseError_En(result.Code());
+    return ss.str();
+}
+
+GAnySchema GAnySchema::compile(const GAny &schema, std::string *error)
+{
+    rapidjson::Document doc;
+    auto generator = [&schema](rapidjson::Document &handler) {
+        return ganyToSax(schema, handler);
+    };
+    doc.Populate(generator);
+    if (doc.HasParseError() || !doc.IsObject()) {
+        setError(error, "Schema must be a JSON object");
+        return {};
+    }
+
+    GAnySchema ret;
+    ret.mImpl = std::make_shared<GAnySchemaImpl>(std::move(doc));
+    return ret;
+}
+
+GAnySchema GAnySchema::parse(const std::string &schemaJson, std::string *error)
+{
+    rapidjson::Document doc;
+    doc.Parse(schemaJson.data(), schemaJson.size());
+    if (doc.HasParseError()) {
+        setError(error, parseError(doc));
+        return {};
+    }
+    if (!doc.IsObject()) {
+        setError(error, "Schema must be a JSON object");
+        return {};
+    }
+
+    GAnySchema ret;
+    ret.mImpl = std::make_shared<GAnySchemaImpl>(std::move(doc));
+    return ret;
+}
+
+bool GAnySchema::isValid() const
+{
+    return mImpl != nullptr;
+}
+
+bool GAnySchema::validate(const GAny &value, std::string *error) const
+{
+    if (!mImpl) {
+        setError(error, "Invalid schema");
+        return false;
+    }
+    rapidjson::SchemaValidator validator(mImpl->schema);
+    if (!ganyToSax(value, validator)) {
+        setError(error, validator.IsValid() ? "Value can not be represented as JSON" : validationError(validator));
+        return false;
+    }
+    return true;
+}
+
+bool GAnySchema::validateJson(const std::string &json, std::string *error) const
+{
+    if (!mImpl) {
+        setError(error, "Invalid schema");
+        return false;
+    }
+    rapidjson::SchemaValidator validator(mImpl->schema);
+    rapidjson::Reader reader;
+    rapidjson::StringStream ss(json.c_str());
+    auto result = reader.Parse(ss, validator);
+    if (!validator.IsValid()) {
+        setError(error, validationError(validator));
+        return false;
+    }
+    if (result.IsError()) {
+        setError(error, parseError(result));
+        return false;
+    }
+    return true;
+}
+
+GAny GAnySchema::parseJson(const std::string &json, std::string *error) const
+{
+    if (!mImpl) {
+        setError(error, "Invalid schema");
+        return {};
+    }
+    GAnyJsonBuilder builder;
+    rapidjson::GenericSchemaValidator<rapidjson::SchemaDocument, GAnyJsonBuilder> validator(mImpl->schema, builder);
+    rapidjson::Reader reader;
+    rapidjson::StringStream ss(json.c_str());
+    auto result = reader.Parse(ss, validator);
+    if (!validator.IsValid()) {
+        setError(error, validationError(validator));
+        return {};
+    }
+    if (result.IsError()) {
+        setError(error, parseError(result));
+        return {};
+    }
+    return std::move(builder.result());
+}
+
+
+/// ================ Reflection ================
+
+void refGAnySchema()
+{
+    GAnyClass::Class < GAnySchema > ()
+            ->setName("GAnySchema")
+            .setDoc("Precompiled JSON Schema validator.")
+            .staticFunc("compile", [](const GAny &schema) {
+                GAnySchema ret = schema.isString()
+                                 ? GAnySchema::parse(schema.as<std::string>())
+                                 : GAnySchema::compile(schema);
+                return ret.isValid() ? GAny(ret) : GAny::null();
+            }, "Compile a schema from a schema object or JSON text, return null on failure.")
+            .func("isValid", &GAnySchema::isValid)
+            .func("validate", [](const GAnySchema &self, const GAny &value) {
+                return self.validate(value);
+            }, "Validate a GAny tree.")
+            .func("validateJson", [](const GAnySchema &self, const std::string &json) {
+                return self.validateJson(json);
+            }, "Validate JSON text.")
+            .func("check", [](const GAnySchema &self, const GAny &value) -> GAny {
+                std::string error;
+                if (self.validate(value, &error)) {
+                    return GAny::null();
+                }
+                return error;
+            }, "Validate a GAny tree, return null on success or the error message.")
+            .func("parseJson", [](const GAnySchema &self, const std::string &json) {
+                return self.parseJson(json);
+            }, "Parse and validate JSON text, return undefined on failure.");
+    GAny::Export(GAnyClass::Class < GAnySchema > ());
+}
+
+GX_NS_END
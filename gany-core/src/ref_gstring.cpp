@@ -133,11 +133,15 @@ void refGString()
             .func("codepoint", [](GString &self, int32_t index) {
                 return (int32_t) self.codepoint(index);
             }, "Get Unicode of the specified character.")
+            .func("isValidUtf8", [](GString &self) {
+                return self.isValidUtf8();
+            }, "Check whether the string is well-formed UTF-8.")
 #if GX_PLATFORM_WINDOWS
             .func("toUtf16", &GString::toUtf16, "Convert string to UTF-16, windows platform only.")
 #endif
             .func("toUpper", &GString::toUpper, "Converts all lowercase letters in a string to uppercase letters.")
             .func("toLower", &GString::toLower, "Converts all uppercase letters in a string to lowercase letters.")
+            .func("caseFold", &GString::caseFold, "Unicode simple case folding, for caseless comparison.")
             .func("arg", [](GString &self, const GAny &value) {
                 return self.arg(value.toString());
             }, "Replace the string of '{}' area with the string of arg1.")
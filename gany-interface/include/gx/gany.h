@@ -31,17 +31,22 @@
 #include "common.h"
 #include "gstring.h"
 #include "gmutex.h"
+#include "gany_alloc.h"
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <charconv>
 #include <cstring>
 #include <functional>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <list>
 #include <map>
 #include <math.h>
 #include <memory>
+#include <optional>
 #include <sstream>
 #include <stack>
 #include <string>
@@ -110,10 +115,10 @@
 
 #define GANY_VERSION_MAJOR 1
 #define GANY_VERSION_MINOR 0
-#define GANY_VERSION_PATCH 3
+#define GANY_VERSION_PATCH 4
 
 // (0 | (GANY_VERSION_PATCH << 16) | ((uint64_t) GANY_VERSION_MINOR << 32) | ((uint64_t) GANY_VERSION_MAJOR << 48))
-#define GANY_VERSION_CODE 0x1000000030000
+#define GANY_VERSION_CODE 0x1000000040000
 
 
 GX_NS_BEGIN
@@ -241,6 +246,10 @@ class GAnyException;
 
 class GAnyCaller;
 
+class GAnyPath;
+
+class GAnyNumber;
+
 class GAnyTypeInfo;
 
 template<typename T>
@@ -578,8 +587,17 @@ public:
 
     GAny _call(std::vector<GAny> &args) const;
 
+    /**
+     * @brief Call a member function if it exists. A missing member yields std::nullopt without throwing,
+     *        exceptions raised by the function itself still propagate.
+     */
+    std::optional<GAny> tryCall(const std::string &function, const GAny **args, int32_t argc) const;
+
+    template<typename... Args>
+    std::optional<GAny> tryCall(const std::string &function, Args &&... args) const;
+
     template<typename... Args>
-    GAny operator()(Args... args) const;
+    GAny operator()(Args &&... args) const;
 
 public:
     GAny operator-() const;                 // Negate
@@ -690,6 +708,26 @@ public:
 
     GAny getItem(const GAny &i) const;          // GetItem
 
+    /**
+     * @brief Same lookup as getItem, but a missing (or undefined) item yields std::nullopt
+     *        instead of undefined or an exception.
+     */
+    std::optional<GAny> tryGetItem(const GAny &i) const;
+
+    /**
+     * @brief Get an element by a compiled path, the path is not re-parsed on each lookup.
+     * @param path  Compiled path (dotted, bracket or JSON Pointer syntax)
+     * @return
+     */
+    GAny getItem(const GAnyPath &path) const;
+
+    /**
+     * @brief Visit all elements matched by a compiled path, including wildcard segments.
+     * @param path      Compiled path
+     * @param callback  function(const GAny &value)->bool, return false to stop visiting
+     */
+    void getItems(const GAnyPath &path, const std::function<bool(const GAny &)> &callback) const;
+
     void setItem(const GAny &i, const GAny &v); // SetItem
 
     void delItem(const GAny &i);                // DelItem
@@ -746,12 +784,26 @@ public:
 
     std::string toJsonString(int indent = -1) const;
 
-    static GAny parseJson(const std::string &json);
+    /**
+     * @brief Parse JSON text.
+     * @param json          JSON text
+     * @param rawNumbers    Keep numbers as their source text (GAnyNumber) instead of int/double
+     * @return Parsed value, an empty object on failure
+     */
+    static GAny parseJson(const std::string &json, bool rawNumbers = false);
 
     static const GAny Import(const std::string &path);
 
     static void Export(GAny clazz);
 
+    /**
+     * @brief Register a name in the env whose content is produced on demand. The first Import touching
+     *        name calls loader exactly once, which should Export the classes of that namespace.
+     * @param name      Top level env name, usually a namespace
+     * @param loader    function()
+     */
+    static void ExportLazy(const std::string &name, const GAny &loader);
+
 private:
     std::ostream &dumpJson(std::ostream &o, int indent = -1, int current_indent = 0) const;
 
@@ -760,6 +812,55 @@ private:
 };
 
 
+namespace detail
+{
+/**
+ * @brief Call argument holder. GAny arguments are passed on by address (no reference count traffic),
+ * other values are converted to a GAny once.
+ */
+template<typename T, bool = std::is_same<typename std::decay<T>::type, GAny>::value>
+class GAnyArg
+{
+public:
+    explicit GAnyArg(T &&v)
+            : mValue(std::forward<T>(v))
+    {}
+
+    const GAny *get() const
+    {
+        return &mValue;
+    }
+
+private:
+    GAny mValue;
+};
+
+template<typename T>
+class GAnyArg<T, true>
+{
+public:
+    explicit GAnyArg(const GAny &v)
+            : mRef(v)
+    {}
+
+    const GAny *get() const
+    {
+        return &mRef;
+    }
+
+private:
+    const GAny &mRef;
+};
+
+template<typename F, typename... Holders>
+auto invokeWithArgs(F &&f, const Holders &... holders)
+{
+    const GAny *args[] = {holders.get()..., nullptr};
+    return f(args, (int32_t) sizeof...(Holders));
+}
+}
+
+
 class GAnyException : public std::exception
 {
 public:
@@ -789,10 +890,20 @@ private:
 
         bool empty() const;
 
-        std::string dump(const std::string &e);
+        /**
+         * Format e with the frames currently on the stack, innermost first. The stack is left as is.
+         */
+        std::string dump(const std::string &e) const;
+
+        /**
+         * Wrap an exception caught in the innermost frame with the call stack. Frames further out find
+         * it traced already and pass the message on unchanged. The next call clears the mark.
+         */
+        std::string trace(const std::string &e);
 
     private:
-        std::stack<const GAnyFunction *> mStack;
+        std::vector<const GAnyFunction *> mStack;
+        bool mTraced = false;
     };
 
 public:
@@ -839,19 +950,11 @@ public:
     GAny _call(const GAny **args, int32_t argc) const;
 
     template<typename... Args>
-    GAny call(Args... args) const
+    GAny call(Args &&... args) const
     {
-        std::initializer_list<GAny> argv = {
-                (GAny(std::move(args)))...
-        };
-
-        auto tArgc = (int32_t) argv.size();
-        const GAny **tArgs = (const GAny **) alloca(sizeof(GAny *) * tArgc);
-        for (int32_t i = 0; i < tArgc; i++) {
-            tArgs[i] = &argv.begin()[i];
-        }
-
-        return _call(tArgs, tArgc);
+        return detail::invokeWithArgs([this](const GAny **tArgs, int32_t tArgc) {
+            return _call(tArgs, tArgc);
+        }, detail::GAnyArg<Args>(std::forward<Args>(args))...);
     }
 
     template<typename Func, typename Return, typename... Args>
@@ -966,6 +1069,121 @@ private:
 };
 
 
+/**
+ * @brief Compiled element path.
+ * Supported syntax:
+ *  - Dotted/bracket: "a.b[0].c", "a.b.0", "a['key.with.dots']", "$.a.b", wildcard "a.*.b" or "a[*]"
+ *  - JSON Pointer (RFC 6901): "/a/b/0", with "~0" for '~' and "~1" for '/'
+ * The path is parsed once, applying it to plain objects and arrays does not allocate.
+ */
+class GAnyPath
+{
+public:
+    struct Segment
+    {
+        GAny key;               ///< Object key (string)
+        GAny indexKey;          ///< Array index (int32), undefined if the segment is not numeric
+        int32_t index = -1;
+        bool wildcard = false;
+    };
+
+public:
+    GAnyPath() = default;
+
+    explicit GAnyPath(const std::string &path);
+
+public:
+    bool isValid() const
+    {
+        return mValid;
+    }
+
+    bool hasWildcard() const
+    {
+        return mHasWildcard;
+    }
+
+    const std::vector<Segment> &segments() const
+    {
+        return mSegments;
+    }
+
+    const std::string &toString() const
+    {
+        return mPath;
+    }
+
+    GAny get(const GAny &root) const;
+
+    void getItems(const GAny &root, const std::function<bool(const GAny &)> &callback) const;
+
+private:
+    bool parseJsonPointer();
+
+    bool parseDotted();
+
+    void addSegment(std::string key, bool literal);
+
+    bool visit(const GAny &cur, size_t segIndex, const std::function<bool(const GAny &)> &callback) const;
+
+    static GAny step(const GAny &cur, const Segment &seg);
+
+private:
+    std::string mPath;
+    std::vector<Segment> mSegments;
+    bool mValid = true;
+    bool mHasWildcard = false;
+};
+
+
+/**
+ * @brief JSON number kept as its source text, produced by GAny::parseJson(json, true).
+ * dumpJson writes the text back unchanged, so big integers and decimals round-trip exactly.
+ * toInt64()/toDouble() convert on first use and cache the result.
+ */
+class GAnyNumber
+{
+public:
+    explicit GAnyNumber(std::string text)
+            : mText(std::move(text))
+    {}
+
+    GAnyNumber(const GAnyNumber &other)
+            : mText(other.mText)
+    {}
+
+public:
+    const std::string &text() const
+    {
+        return mText;
+    }
+
+    /**
+     * @brief Whether the text is an integer literal (no fraction or exponent).
+     */
+    bool isInteger() const
+    {
+        return mText.find_first_of(".eE") == std::string::npos;
+    }
+
+    int64_t toInt64() const;
+
+    double toDouble() const;
+
+private:
+    enum : uint8_t
+    {
+        CachedInt64 = 0x01,
+        CachedDouble = 0x02,
+    };
+
+    std::string mText;
+    mutable std::atomic<uint8_t> mCached{0};
+    mutable std::atomic<int64_t> mInt64{0};
+    mutable std::atomic<double> mDouble{0};
+};
+
+
 class GAnyTypeInfo
 {
 public:
@@ -1263,19 +1481,11 @@ public:
 
 public:
     template<typename... Args>
-    GAny call(const GAny &inst, const std::string &function, Args... args) const
+    GAny call(const GAny &inst, const std::string &function, Args &&... args) const
     {
-        std::initializer_list<GAny> argv = {
-                (GAny(std::move(args)))...
-        };
-
-        auto tArgc = (int32_t) argv.size();
-        const GAny **tArgs = (const GAny **) alloca(sizeof(GAny *) * tArgc);
-        for (int32_t i = 0; i < tArgc; i++) {
-            tArgs[i] = &argv.begin()[i];
-        }
-
-        return _call(inst, function, tArgs, tArgc);
+        return detail::invokeWithArgs([&](const GAny **tArgs, int32_t tArgc) {
+            return _call(inst, function, tArgs, tArgc);
+        }, detail::GAnyArg<Args>(std::forward<Args>(args))...);
     }
 
     GAny _call(const GAny &inst, const std::string &function, const GAny **args, int32_t argc) const;
@@ -1293,13 +1503,27 @@ public:
     GAny _new(std::vector<GAny> &args) const;
 
     template<typename... Args>
-    GAny _new(Args... args) const;
+    GAny _new(Args &&... args) const;
 
 public:
     template<typename T>
     static std::shared_ptr<GAnyClass> instance()
     {
-        return _instance(GAnyTypeInfoP<T>());
+        // The core never replaces the class of a type, so each module resolves it once per T.
+        static std::shared_ptr<GAnyClass> sClass;
+        static std::atomic<bool> sResolved(false);
+        if (sResolved.load(std::memory_order_acquire)) {
+            return sClass;
+        }
+        auto cls = _instance(GAnyTypeInfoP<T>());
+        if (cls) {
+            static std::once_flag sOnce;
+            std::call_once(sOnce, [&cls]() {
+                sClass = cls;
+                sResolved.store(true, std::memory_order_release);
+            });
+        }
+        return cls;
     }
 
     template<typename T>
@@ -1363,6 +1587,19 @@ private:
 
     GAny getItem(const GAny &inst, const GAny &i) const;
 
+    /**
+     * Non-throwing getItem: returns false when no attribute, getItem function or parent provides the item.
+     * When errors is given, the messages getItem would report are appended to it.
+     */
+    bool _tryGetItem(const GAny &inst, const GAny &i, GAny &out, std::string *errors = nullptr) const;
+
+    /**
+     * Non-throwing _call: returns false when neither this class nor a parent could call the method,
+     * with the messages _call would report appended to errors.
+     */
+    bool _tryCall(const GAny &inst, const std::string &function, const GAny **args, int32_t argc,
+                  GAny &out, std::string &errors) const;
+
     bool setItem(const GAny &inst, const GAny &i, const GAny &v);
 
     void updateHash();
@@ -1493,6 +1730,16 @@ private:
 };
 
 
+/**
+ * Change counter of the global environment, bumped on every registration or removal.
+ * The env object hands it out through GAnyValue::as, so modules can validate cached lookups.
+ */
+struct GAnyEnvVersion
+{
+    std::atomic<uint64_t> value{0};
+};
+
+
 class GAnyValue
 {
 public:
@@ -1531,6 +1778,23 @@ public:
     {
         return GAny();
     }
+
+public:
+    /**
+     * @brief Allocate a value from the GAnyArena active on this thread, or from the default GAnyMemoryResource.
+     */
+    template<typename V, typename... Args>
+    static std::shared_ptr<GAnyValue> make(Args &&... args)
+    {
+        GAnyMemoryResource *resource = GAnyArenaResource::current();
+        if (!resource) {
+            resource = GAnyMemoryResource::getDefault();
+        }
+        if (resource) {
+            return std::allocate_shared<V>(GAnyResourceAllocator<V>(resource), std::forward<Args>(args)...);
+        }
+        return std::make_shared<V>(std::forward<Args>(args)...);
+    }
 };
 
 
@@ -1710,7 +1974,7 @@ public:
     }
 
     GAnyObject(std::unordered_map<std::string, GAny> &&o)
-            : GAnyValueP<std::unordered_map<std::string, GAny>>(o)
+            : GAnyValueP<std::unordered_map<std::string, GAny>>(std::move(o))
     {
     }
 
@@ -1968,7 +2232,7 @@ public:
 
     static GAny to(const std::vector<T> &var)
     {
-        return (std::shared_ptr<GAnyValue>) std::make_shared<GAnyArray>(
+        return GAnyValue::make<GAnyArray>(
                 std::vector<GAny>(var.begin(), var.end()));
     }
 };
@@ -1987,12 +2251,12 @@ public:
 
     static GAny to(const std::vector<GAny> &var)
     {
-        return (std::shared_ptr<GAnyValue>) std::make_shared<GAnyArray>(var);
+        return GAnyValue::make<GAnyArray>(var);
     }
 
     static GAny to(std::vector<GAny> &&var)
     {
-        return (std::shared_ptr<GAnyValue>) std::make_shared<GAnyArray>(std::move(var));
+        return GAnyValue::make<GAnyArray>(std::move(var));
     }
 };
 
@@ -2025,7 +2289,7 @@ public:
 
     static GAny to(const std::list<T> &var)
     {
-        return (std::shared_ptr<GAnyValue>) std::make_shared<GAnyArray>(
+        return GAnyValue::make<GAnyArray>(
                 std::vector<GAny>(var.begin(), var.end()));
     }
 };
@@ -2059,7 +2323,7 @@ public:
 
     static GAny to(const std::map<std::string, T> &var)
     {
-        return (std::shared_ptr<GAnyValue>) std::make_shared<GAnyObject>(
+        return GAnyValue::make<GAnyObject>(
                 std::unordered_map<std::string, GAny>(var.begin(), var.end()));
     }
 };
@@ -2093,7 +2357,7 @@ public:
 
     static GAny to(const std::unordered_map<std::string, T> &var)
     {
-        return (std::shared_ptr<GAnyValue>) std::make_shared<GAnyObject>(
+        return GAnyValue::make<GAnyObject>(
                 std::unordered_map<std::string, GAny>(var.begin(), var.end()));
     }
 };
@@ -2263,14 +2527,14 @@ template<class T>
 GAny GAny::create(const T &t)
 {
     static_assert(!std::is_same<T, GAny>::value, "This should not happen.");
-    return (std::shared_ptr<GAnyValue>) std::make_shared<GAnyValueP<T>>(t);
+    return GAnyValue::make<GAnyValueP<T>>(t);
 }
 
 template<class T>
 GAny GAny::create(T &&t)
 {
     static_assert(!std::is_same<T, GAny>::value, "This should not happen.");
-    return (std::shared_ptr<GAnyValue>) std::make_shared<GAnyValueP<typename std::remove_reference<T>::type>>(
+    return GAnyValue::make<GAnyValueP<typename std::remove_reference<T>::type>>(
             std::forward<T>(t));
 }
 
@@ -2428,6 +2692,14 @@ void GAny::set(const std::string &name, const T &v)
     setItem(name, v);
 }
 
+template<typename... Args>
+std::optional<GAny> GAny::tryCall(const std::string &function, Args &&... args) const
+{
+    return detail::invokeWithArgs([this, &function](const GAny **tArgs, int32_t tArgc) {
+        return tryCall(function, tArgs, tArgc);
+    }, detail::GAnyArg<Args>(std::forward<Args>(args))...);
+}
+
 template<typename... Args>
 GAny GAny::call(const std::string &function, Args &&... args) const
 {
@@ -2442,19 +2714,11 @@ GAny GAny::call(const std::string &function, Args &&... args) const
 }
 
 template<typename... Args>
-GAny GAny::operator()(Args... args) const
+GAny GAny::operator()(Args &&... args) const
 {
-    std::initializer_list<GAny> argv = {
-            (GAny(std::move(args)))...
-    };
-
-    auto tArgc = (int32_t) argv.size();
-    const GAny **tArgs = (const GAny **) alloca(sizeof(GAny *) * tArgc);
-    for (int32_t i = 0; i < tArgc; i++) {
-        tArgs[i] = &argv.begin()[i];
-    }
-
-    return _call(tArgs, tArgc);
+    return detail::invokeWithArgs([this](const GAny **tArgs, int32_t tArgc) {
+        return _call(tArgs, tArgc);
+    }, detail::GAnyArg<Args>(std::forward<Args>(args))...);
 }
 
 
@@ -2501,7 +2765,9 @@ inline GAny GAny::array(const std::list<GAny> &lst)
 
 inline GAny GAny::undefined()
 {
-    return std::make_shared<GAnyValue>();
+    // GAnyValue holds no state, so every undefined value shares one instance instead of allocating.
+    static const std::shared_ptr<GAnyValue> sUndefined = GAnyValue::make<GAnyValue>();
+    return sUndefined;
 }
 
 inline GAny GAny::null()
@@ -2822,6 +3088,30 @@ inline GAny GAny::_call(const std::string &function, const GAny **args, int32_t
     return classObject()._call(*this, function, args, argc);
 }
 
+inline std::optional<GAny> GAny::tryCall(const std::string &function, const GAny **args, int32_t argc) const
+{
+    if (isUndefined()) {
+        return std::nullopt;
+    }
+    if (isClass()) {
+        if (!as<GAnyClass>().findMember(function).isFunction()) {
+            return std::nullopt;
+        }
+        return as<GAnyClass>()._call(GAny(), function, args, argc);
+    } else if (!isUserObject() && isObject()) {
+        auto func = tryGetItem(function);
+        if (!func || !(func->isFunction() || func->type() == AnyType::caller_t)) {
+            return std::nullopt;
+        }
+        return func->_call(args, argc);
+    }
+    const auto &clazz = classObject();
+    if (!clazz.findMember(function).isFunction()) {
+        return std::nullopt;
+    }
+    return clazz._call(*this, function, args, argc);
+}
+
 inline GAny GAny::_call(const std::string &function, std::vector<GAny> &args) const
 {
     auto tArgc = (int32_t) args.size();
@@ -3220,21 +3510,17 @@ inline GAny GAny::getItem(const GAny &i) const
     }
 
     if (i.isString() && !isArray()) {
-        GString si(i.castAs<std::string>());
-        if (si.indexOf(".") > 0) {
-            auto paths = si.split(".");
-            if (!paths.empty()) {
-                GAny ret = *this;
-                for (const auto &path: paths) {
-                    std::string p = path.toStdString();
-                    if (p.empty()) {
-                        continue;
-                    }
-                    ret = ret.getItem(p);
+        const auto &key = i.unsafeAs<std::string>();
+        const size_t dot = key.find('.');
+        if (dot != std::string::npos && dot > 0) {
+            GString si(key);
+            GAny ret = *this;
+            si.tokenize(".", [&ret](std::string_view path) {
+                if (!path.empty()) {
+                    ret = ret.getItem(std::string(path));
                 }
-                return ret;
-            }
-            return GAny::undefined();
+            });
+            return ret;
         }
     }
 
@@ -3243,28 +3529,21 @@ inline GAny GAny::getItem(const GAny &i) const
             return GAny::undefined();
         }
         auto &obj = as<GAnyObject>();
-        const auto &key = i.castAs<std::string>();
-        GAny v = obj[key];
+        GAny v = obj[i.unsafeAs<std::string>()];
 
         if (v.isUndefined()) {
-            try {
-                v = classObject().getItem((*this), i);
-            } catch (GAnyException &e) {
-                if (this->isClass() || this->isUserObject()) {
-                    throw GAnyException(e);
-                }
-                v = GAny::undefined();
+            if (this->isClass() || this->isUserObject()) {
+                return classObject().getItem((*this), i);
             }
+            classObject()._tryGetItem((*this), i, v);
         }
         return v;
     }
     if (isArray()) {
         if (i.isString()) {
-            try {
-                return classObject().getItem((*this), i);
-            } catch (GAnyException &) {
-                return GAny::undefined();
-            }
+            GAny v;
+            classObject()._tryGetItem((*this), i, v);
+            return v;
         }
         auto &arr = as<GAnyArray>();
         return arr[i.toInt32()];
@@ -3282,6 +3561,71 @@ inline GAny GAny::getItem(const GAny &i) const
     return classObject().getItem((*this), i);
 }
 
+inline std::optional<GAny> GAny::tryGetItem(const GAny &i) const
+{
+    if (isUndefined()) {
+        return std::nullopt;
+    }
+
+    if (i.isString() && !isArray()) {
+        const auto &key = i.unsafeAs<std::string>();
+        const size_t dot = key.find('.');
+        if (dot != std::string::npos && dot > 0) {
+            GString si(key);
+            std::optional<GAny> ret = *this;
+            si.tokenize(".", [&ret](std::string_view path) {
+                if (ret && !path.empty()) {
+                    ret = ret->tryGetItem(std::string(path));
+                }
+            });
+            return ret;
+        }
+    }
+
+    GAny v;
+    if (isObject()) {
+        if (!i.isString()) {
+            return std::nullopt;
+        }
+        v = as<GAnyObject>()[i.unsafeAs<std::string>()];
+        if (v.isUndefined() && !classObject()._tryGetItem(*this, i, v)) {
+            return std::nullopt;
+        }
+    } else if (isArray()) {
+        if (i.isString()) {
+            if (!classObject()._tryGetItem(*this, i, v)) {
+                return std::nullopt;
+            }
+        } else {
+            v = as<GAnyArray>()[i.toInt32()];
+        }
+    } else if (isEnum()) {
+        if (!i.isString()) {
+            return std::nullopt;
+        }
+        return as<GAnyClass::GAnyEnum>().enumObj.tryGetItem(i);
+    } else if (isClass() && i.isString()) {
+        v = as<GAnyClass>().findMember(i.toString());
+    } else if (!classObject()._tryGetItem(*this, i, v)) {
+        return std::nullopt;
+    }
+
+    if (v.isUndefined()) {
+        return std::nullopt;
+    }
+    return v;
+}
+
+inline GAny GAny::getItem(const GAnyPath &path) const
+{
+    return path.get(*this);
+}
+
+inline void GAny::getItems(const GAnyPath &path, const std::function<bool(const GAny &)> &callback) const
+{
+    path.getItems(*this, callback);
+}
+
 inline void GAny::setItem(const GAny &i, const GAny &v)
 {
     if (isUndefined()) {
@@ -3834,6 +4178,25 @@ inline std::ostream &GAny::dumpJson(std::ostream &o, const int indent, const int
         out += '"';
         return out;
     };
+    // Shortest text that reads back to the same value.
+    static auto dump_real = [](std::ostream &o, double value, bool single) -> std::ostream & {
+        char buf[32];
+#if defined(__cpp_lib_to_chars)
+        const auto r = single
+                       ? std::to_chars(buf, buf + sizeof(buf), (float) value)
+                       : std::to_chars(buf, buf + sizeof(buf), value);
+        return o.write(buf, r.ptr - buf);
+#else
+        int len = 0;
+        for (int precision = single ? 6 : 15; precision <= (single ? 9 : 17); precision++) {
+            len = snprintf(buf, sizeof(buf), "%.*g", precision, value);
+            if (single ? strtof(buf, nullptr) == (float) value : strtod(buf, nullptr) == value) {
+                break;
+            }
+        }
+        return o.write(buf, len);
+#endif
+    };
     switch (type()) {
         case AnyType::undefined_t: {
             return o;
@@ -3875,14 +4238,10 @@ inline std::ostream &GAny::dumpJson(std::ostream &o, const int indent, const int
             }
         }
         case AnyType::float_t: {
-            std::stringstream floats;
-            floats << std::setprecision(7) << castAs<float>();
-            return o << floats.str();
+            return dump_real(o, castAs<float>(), true);
         }
         case AnyType::double_t: {
-            std::stringstream floats;
-            floats << std::setprecision(15) << castAs<double>();
-            return o << floats.str();
+            return dump_real(o, castAs<double>(), false);
         }
         case AnyType::string_t: {
             return o << dump_str(castAs<std::string>());
@@ -3959,6 +4318,9 @@ inline std::ostream &GAny::dumpJson(std::ostream &o, const int indent, const int
             return o << "\"<Class: " << cl.mName << ">\"";
         }
         default: {
+            if (is<GAnyNumber>()) {
+                return o << as<GAnyNumber>().text();
+            }
             if (type() == AnyType::user_obj_t && classObject().containsMember(MetaFunction::ToObject)) {
                 return toObject().dumpJson(o, indent, current_indent);
             }
@@ -3982,22 +4344,51 @@ inline std::string GAny::toJsonString(int indent) const
     return sst.str();
 }
 
-inline GAny GAny::parseJson(const std::string &json)
+inline GAny GAny::parseJson(const std::string &json, bool rawNumbers)
 {
     GAny obj = GAny::object();
     if (pfnGanyParseJson) {
-        pfnGanyParseJson(json.c_str(), &obj);
+        pfnGanyParseJson(json.c_str(), rawNumbers, &obj);
     }
     return obj;
 }
 
 inline const GAny GAny::Import(const std::string &path)
 {
-    if (pfnGanyGetEnv && !path.empty()) {
-        const GAny env = *reinterpret_cast<GAny *>(pfnGanyGetEnv());
+    if (!pfnGanyGetEnv || path.empty()) {
+        return GAny::undefined();
+    }
+    const GAny &env = *reinterpret_cast<GAny *>(pfnGanyGetEnv());
+    // The env object held by the env GAny is itself a GAnyValue, it hands out the change counter through as().
+    static const auto *envVersion = reinterpret_cast<const GAnyEnvVersion *>(
+            static_cast<const GAnyValue *>(env.value()->ptr())->as(typeid(GAnyEnvVersion)));
+    if (!envVersion) {
         return env.getItem(path);
     }
-    return GAny::undefined();
+
+    // Resolved classes are cached per thread until the env changes, other values may change in place.
+    struct ImportCacheEntry
+    {
+        uint64_t version;
+        GAny value;
+    };
+    thread_local std::unordered_map<std::string, ImportCacheEntry> sImportCache;
+
+    const uint64_t version = envVersion->value.load(std::memory_order_acquire);
+    auto it = sImportCache.find(path);
+    if (it != sImportCache.end() && it->second.version == version) {
+        return it->second.value;
+    }
+    GAny ret = env.getItem(path);
+    if (ret.isClass()) {
+        if (sImportCache.size() >= 512) {
+            sImportCache.clear();
+        }
+        sImportCache[path] = ImportCacheEntry{version, ret};
+    } else if (it != sImportCache.end()) {
+        sImportCache.erase(it);
+    }
+    return ret;
 }
 
 inline void GAny::Export(GAny clazz)
@@ -4007,6 +4398,14 @@ inline void GAny::Export(GAny clazz)
     }
 }
 
+inline void GAny::ExportLazy(const std::string &name, const GAny &loader)
+{
+    if (pfnGanyGetEnv && !name.empty()) {
+        const GAny env = *reinterpret_cast<GAny *>(pfnGanyGetEnv());
+        env.call("exportLazy", name, loader);
+    }
+}
+
 /// ================ GAnyFunction ================
 
 inline GAnyFunction GAnyFunction::createVariadicFunction(const std::string &name, const std::string &doc,
@@ -4029,18 +4428,16 @@ inline GAny GAnyFunction::_call(const GAny **args, int32_t argc) const
     // [1] perfect match
     for (const GAnyFunction *overload = this; overload != nullptr; overload = &overload->mNext.as<GAnyFunction>()) {
         if (overload->matchingArgv(args, argc)) {
+            callStack.push(this);
             try {
-                callStack.push(this);
                 GAny ret = overload->mFunc(args, argc);
                 callStack.pop();
                 return ret;
             }
             catch (std::exception &e) {
-                if (callStack.empty()) {
-                    throw GAnyException(e.what());
-                } else {
-                    throw GAnyException(callStack.dump(e.what()));
-                }
+                std::string what = callStack.trace(e.what());
+                callStack.pop();
+                throw GAnyException(what);
             }
             break;
         } else if (!overload->mDoCheckArgs || (overload->mArgTypes.size() == argc + 1)) {
@@ -4055,18 +4452,15 @@ inline GAny GAnyFunction::_call(const GAny **args, int32_t argc) const
     std::string lastException;
     // [2] fuzzy matching
     for (const GAnyFunction *overload: unmatched) {
+        callStack.push(this);
         try {
-            callStack.push(this);
             GAny ret = overload->mFunc(args, argc);
             callStack.pop();
             return ret;
         }
         catch (std::exception &e) {
-            if (callStack.empty()) {
-                lastException = e.what();
-            } else {
-                lastException = callStack.dump(e.what());
-            }
+            lastException = callStack.trace(e.what());
+            callStack.pop();
         }
     }
 
@@ -4081,7 +4475,9 @@ inline GAny GAnyFunction::_call(const GAny **args, int32_t argc) const
         }
         exStream << "]. ";
         callStack.push(this);
-        throw GAnyException(callStack.dump(exStream.str()));
+        std::string what = callStack.trace(exStream.str());
+        callStack.pop();
+        throw GAnyException(what);
     }
     return GAny::undefined();
 }
@@ -4216,12 +4612,13 @@ void GAnyFunction::initialize(Func &&f, Return (*)(Args...), const std::string &
 
 inline void GAnyFunction::CallStack::push(const GAnyFunction *f)
 {
-    mStack.push(f);
+    mStack.push_back(f);
+    mTraced = false;
 }
 
 inline void GAnyFunction::CallStack::pop()
 {
-    mStack.pop();
+    mStack.pop_back();
 }
 
 inline bool GAnyFunction::CallStack::empty() const
@@ -4229,21 +4626,27 @@ inline bool GAnyFunction::CallStack::empty() const
     return mStack.empty();
 }
 
-inline std::string GAnyFunction::CallStack::dump(const std::string &e)
+inline std::string GAnyFunction::CallStack::dump(const std::string &e) const
 {
     std::stringstream stream;
     stream << "Exception: \n" << e;
 
-    while(!mStack.empty()) {
-        auto *f = mStack.top();
-        mStack.pop();
-
-        stream << "\n    at " << f->signature();
+    for (auto it = mStack.rbegin(); it != mStack.rend(); ++it) {
+        stream << "\n    at " << (*it)->signature();
     }
 
     return stream.str();
 }
 
+inline std::string GAnyFunction::CallStack::trace(const std::string &e)
+{
+    if (mTraced) {
+        return e;
+    }
+    mTraced = true;
+    return dump(e);
+}
+
 /// ================ GAnyTypeInfo ================
 
 inline GAnyTypeInfo::GAnyTypeInfo(std::type_index typeIndex)
@@ -4337,6 +4740,290 @@ inline GAny GAnyCaller::call(const GAny **args, int32_t argc) const
     return mObj.classObject()._call(mObj, mMethodName, args, argc);
 }
 
+/// ================ GAnyPath ================
+
+inline GAnyPath::GAnyPath(const std::string &path)
+        : mPath(path)
+{
+    mValid = (!mPath.empty() && mPath[0] == '/') ? parseJsonPointer() : parseDotted();
+    if (!mValid) {
+        mSegments.clear();
+        mHasWildcard = false;
+    }
+}
+
+inline GAny GAnyPath::get(const GAny &root) const
+{
+    if (!mValid) {
+        return GAny::undefined();
+    }
+    if (mHasWildcard) {
+        GAny ret = GAny::undefined();
+        visit(root, 0, [&ret](const GAny &v) {
+            ret = v;
+            return false;
+        });
+        return ret;
+    }
+    GAny cur = root;
+    for (const auto &seg: mSegments) {
+        cur = step(cur, seg);
+        if (cur.isUndefined()) {
+            break;
+        }
+    }
+    return cur;
+}
+
+inline void GAnyPath::getItems(const GAny &root, const std::function<bool(const GAny &)> &callback) const
+{
+    if (!mValid || !callback) {
+        return;
+    }
+    visit(root, 0, callback);
+}
+
+inline bool GAnyPath::parseJsonPointer()
+{
+    size_t pos = 1;
+    while (true) {
+        size_t end = mPath.find('/', pos);
+        if (end == std::string::npos) {
+            end = mPath.size();
+        }
+        std::string key;
+        key.reserve(end - pos);
+        for (size_t i = pos; i < end; i++) {
+            if (mPath[i] != '~') {
+                key.push_back(mPath[i]);
+                continue;
+            }
+            if (i + 1 >= end) {
+                return false;
+            }
+            const char esc = mPath[++i];
+            if (esc == '0') {
+                key.push_back('~');
+            } else if (esc == '1') {
+                key.push_back('/');
+            } else {
+                return false;
+            }
+        }
+        // JSON Pointer array indices do not allow leading zeros.
+        const bool leadingZero = key.size() > 1 && key[0] == '0';
+        addSegment(std::move(key), leadingZero);
+        if (end == mPath.size()) {
+            break;
+        }
+        pos = end + 1;
+    }
+    return true;
+}
+
+inline bool GAnyPath::parseDotted()
+{
+    const size_t n = mPath.size();
+    size_t i = 0;
+    if (n > 0 && mPath[0] == '$') {
+        i = 1;
+    }
+    while (i < n) {
+        const char c = mPath[i];
+        if (c == '.') {
+            i++;
+            continue;
+        }
+        if (c == '[') {
+            size_t j = i + 1;
+            if (j < n && (mPath[j] == '\'' || mPath[j] == '"')) {
+                const size_t q = mPath.find(mPath[j], j + 1);
+                if (q == std::string::npos || q + 1 >= n || mPath[q + 1] != ']') {
+                    return false;
+                }
+                addSegment(mPath.substr(j + 1, q - j - 1), true);
+                i = q + 2;
+                continue;
+            }
+            const size_t close = mPath.find(']', j);
+            if (close == std::string::npos) {
+                return false;
+            }
+            addSegment(mPath.substr(j, close - j), false);
+            i = close + 1;
+            continue;
+        }
+        size_t j = i;
+        while (j < n && mPath[j] != '.' && mPath[j] != '[') {
+            j++;
+        }
+        addSegment(mPath.substr(i, j - i), false);
+        i = j;
+    }
+    return true;
+}
+
+inline void GAnyPath::addSegment(std::string key, bool literal)
+{
+    Segment seg;
+    if (!literal && key == "*") {
+        seg.wildcard = true;
+        mHasWildcard = true;
+        mSegments.push_back(std::move(seg));
+        return;
+    }
+    if (!literal && !key.empty() && key.size() <= 9
+        && std::all_of(key.begin(), key.end(), [](char ch) { return ch >= '0' && ch <= '9'; })) {
+        seg.index = std::stoi(key);
+        seg.indexKey = seg.index;
+    }
+    seg.key = std::move(key);
+    mSegments.push_back(std::move(seg));
+}
+
+inline bool GAnyPath::visit(const GAny &cur, size_t segIndex, const std::function<bool(const GAny &)> &callback) const
+{
+    if (segIndex == mSegments.size()) {
+        return cur.isUndefined() || callback(cur);
+    }
+    const auto &seg = mSegments[segIndex];
+    if (!seg.wildcard) {
+        GAny next = step(cur, seg);
+        return next.isUndefined() || visit(next, segIndex + 1, callback);
+    }
+
+    // Children are copied out first, so that the callback may access the container.
+    std::vector<GAny> children;
+    if (cur.isObject()) {
+        const auto &obj = cur.as<GAnyObject>();
+        std::lock_guard locker(obj.lock);
+        children.reserve(obj.var.size());
+        for (const auto &item: obj.var) {
+            children.push_back(item.second);
+        }
+    } else if (cur.isArray()) {
+        const auto &arr = cur.as<GAnyArray>();
+        std::lock_guard locker(arr.lock);
+        children = arr.var;
+    } else {
+        for (GAny it = cur.iterator(); it.hasNext();) {
+            children.push_back(it.next().second);
+        }
+    }
+    for (const auto &child: children) {
+        if (!visit(child, segIndex + 1, callback)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline GAny GAnyPath::step(const GAny &cur, const Segment &seg)
+{
+    switch (cur.type()) {
+        case AnyType::undefined_t:
+        case AnyType::null_t:
+            return GAny::undefined();
+        case AnyType::object_t: {
+            const auto &obj = cur.as<GAnyObject>();
+            std::lock_guard locker(obj.lock);
+            auto it = obj.var.find(seg.key.unsafeAs<std::string>());
+            if (it == obj.var.end()) {
+                return GAny::undefined();
+            }
+            return it->second;
+        }
+        case AnyType::array_t: {
+            if (seg.index < 0) {
+                return GAny::undefined();
+            }
+            return cur.as<GAnyArray>()[seg.index];
+        }
+        default:
+            break;
+    }
+    if (cur.isObject()) {
+        // Dynamic class instances, members are resolved by the class as well.
+        const auto &obj = cur.as<GAnyObject>();
+        {
+            std::lock_guard locker(obj.lock);
+            auto it = obj.var.find(seg.key.unsafeAs<std::string>());
+            if (it != obj.var.end()) {
+                return it->second;
+            }
+        }
+    }
+    try {
+        if (seg.index >= 0) {
+            if (auto ret = cur.tryGetItem(seg.indexKey)) {
+                return *ret;
+            }
+        }
+        return cur.tryGetItem(seg.key).value_or(GAny::undefined());
+    } catch (GAnyException &) {
+    }
+    return GAny::undefined();
+}
+
+/// ================ GAnyNumber ================
+
+inline int64_t GAnyNumber::toInt64() const
+{
+    if (mCached.load(std::memory_order_acquire) & CachedInt64) {
+        return mInt64.load(std::memory_order_relaxed);
+    }
+
+    int64_t v = 0;
+    bool parsed = false;
+    if (isInteger()) {
+        const char *begin = mText.data();
+        const char *end = begin + mText.size();
+        parsed = std::from_chars(begin, end, v).ec == std::errc();
+        if (!parsed && !mText.empty() && mText[0] != '-') {
+            // Values above INT64_MAX wrap the same way a uint64 GAny does.
+            uint64_t u = 0;
+            if (std::from_chars(begin, end, u).ec == std::errc()) {
+                v = (int64_t) u;
+                parsed = true;
+            }
+        }
+    }
+    if (!parsed) {
+        const double d = toDouble();
+        if (d != d) {
+            v = 0;
+        } else if (d >= 9223372036854775807.0) {
+            v = std::numeric_limits<int64_t>::max();
+        } else if (d <= -9223372036854775808.0) {
+            v = std::numeric_limits<int64_t>::min();
+        } else {
+            v = (int64_t) d;
+        }
+    }
+
+    mInt64.store(v, std::memory_order_relaxed);
+    mCached.fetch_or(CachedInt64, std::memory_order_release);
+    return v;
+}
+
+inline double GAnyNumber::toDouble() const
+{
+    if (mCached.load(std::memory_order_acquire) & CachedDouble) {
+        return mDouble.load(std::memory_order_relaxed);
+    }
+
+    double v = 0;
+#if defined(__cpp_lib_to_chars)
+    std::from_chars(mText.data(), mText.data() + mText.size(), v);
+#else
+    v = strtod(mText.c_str(), nullptr);
+#endif
+
+    mDouble.store(v, std::memory_order_relaxed);
+    mCached.fetch_or(CachedDouble, std::memory_order_release);
+    return v;
+}
+
 /// ================ GAnyClass ================
 
 inline GAnyClass::GAnyClass(std::string nameSpace, std::string name, std::string doc, const GAnyTypeInfo &typeInfo)
@@ -4483,52 +5170,74 @@ inline GAnyClass &GAnyClass::inherit(const GAny &parent)
 
 inline GAny GAnyClass::_call(const GAny &inst, const std::string &function, const GAny **args, int32_t argc) const
 {
-    std::stringstream sst;
+    GAny ret;
+    std::string errors;
+    if (_tryCall(inst, function, args, argc, ret, errors)) {
+        return ret;
+    }
+    if (errors.empty()) {
+        throw GAnyException("Class " + mName + " failed to call method " + function + ".");
+    }
+    throw GAnyException(errors);
+    return GAny::undefined();
+}
 
+inline bool GAnyClass::_tryCall(const GAny &inst, const std::string &function, const GAny **args, int32_t argc,
+                                GAny &out, std::string &errors) const
+{
     GAny *attr = getAttr(function);
     if (attr && attr->isFunction()) {
-        try {
-            const auto &func = attr->as<GAnyFunction>();
-            if (func.mIsMethod) {
-                if (inst.isUndefined()) {
-                    throw GAnyException("Method should be called with self.");
-                }
+        const auto &func = attr->as<GAnyFunction>();
+        if (func.mIsMethod && inst.isUndefined()) {
+            errors += "Method should be called with self.\n";
+        } else {
+            try {
+                if (func.mIsMethod) {
+                    auto tArgc = argc + 1;
+                    const GAny **tArgs = (const GAny **) alloca(sizeof(GAny *) * tArgc);
+                    tArgs[0] = &inst;
+                    for (int32_t i = 0; i < argc; i++) {
+                        tArgs[i + 1] = args[i];
+                    }
 
-                auto tArgc = argc + 1;
-                const GAny **tArgs = (const GAny **) alloca(sizeof(GAny *) * tArgc);
-                tArgs[0] = &inst;
-                for (int32_t i = 0; i < argc; i++) {
-                    tArgs[i + 1] = args[i];
+                    out = func._call(tArgs, tArgc);
+                } else {
+                    out = func._call(args, argc);
                 }
-
-                return func._call(tArgs, tArgc);
-            } else {
-                return func._call(args, argc);
+                return true;
+            } catch (GAnyException &e) {
+                errors += e.what();
+                errors += "\n";
             }
-        } catch (GAnyException &e) {
-            sst << e.what() << "\n";
         }
     }
 
     for (const GAny &p: this->mParents) {
-        try {
-            if (p.isClass()) {
-                return p.as<GAnyClass>()._call(inst, function, args, argc);
+        const GAnyClass *pClass;
+        GAny pInst;
+        if (p.isClass()) {
+            pClass = &p.as<GAnyClass>();
+            pInst = inst;
+        } else {
+            try {
+                pClass = &p.getItem(0).as<GAnyClass>();
+                pInst = p.getItem(1)(inst);
+            } catch (GAnyException &e) {
+                errors += e.what();
+                continue;
             }
-            return p.getItem(0).as<GAnyClass>()._call(p.getItem(1)(inst), function, args, argc);
         }
-        catch (GAnyException &e) {
-            sst << e.what();
-            continue;
+        std::string pErrors;
+        if (pClass->_tryCall(pInst, function, args, argc, out, pErrors)) {
+            return true;
+        }
+        if (pErrors.empty()) {
+            errors += "Class " + pClass->mName + " failed to call method " + function + ".";
+        } else {
+            errors += pErrors;
         }
     }
-    std::string ssts = sst.str();
-    if (ssts.empty()) {
-        throw GAnyException("Class " + mName + " failed to call method " + function + ".");
-    } else {
-        throw GAnyException(ssts);
-    }
-    return GAny::undefined();
+    return false;
 }
 
 inline void GAnyClass::makeConstructor(GAny fVar)
@@ -4598,19 +5307,11 @@ inline GAny GAnyClass::_new(std::vector<GAny> &args) const
 }
 
 template<typename... Args>
-GAny GAnyClass::_new(Args... args) const
+GAny GAnyClass::_new(Args &&... args) const
 {
-    std::initializer_list<GAny> argv = {
-            (GAny(std::move(args)))...
-    };
-
-    auto tArgc = (int32_t) argv.size();
-    const GAny **tArgs = (const GAny **) alloca(sizeof(GAny *) * tArgc);
-    for (int32_t i = 0; i < tArgc; i++) {
-        tArgs[i] = &argv.begin()[i];
-    }
-
-    return _new(tArgs, tArgc);
+    return detail::invokeWithArgs([this](const GAny **tArgs, int32_t tArgc) {
+        return _new(tArgs, tArgc);
+    }, detail::GAnyArg<Args>(std::forward<Args>(args))...);
 }
 
 inline void GAnyClass::updateHash()
@@ -4786,8 +5487,17 @@ inline GAny *GAnyClass::setAttr(const std::string &name, const GAny &attr)
 
 inline GAny GAnyClass::getItem(const GAny &inst, const GAny &i) const
 {
-    std::stringstream sst;
+    GAny ret;
+    std::string errors;
+    if (_tryGetItem(inst, i, ret, &errors)) {
+        return ret;
+    }
+    throw GAnyException("Class " + mName + " don't know how to do getItem " + i.toString() + ". \n" + errors);
+    return GAny::undefined();
+}
 
+inline bool GAnyClass::_tryGetItem(const GAny &inst, const GAny &i, GAny &out, std::string *errors) const
+{
     while (i.isString()) {
         GAny *attr = getAttr(i.toString());
         if (!attr) {
@@ -4797,55 +5507,74 @@ inline GAny GAnyClass::getItem(const GAny &inst, const GAny &i) const
             auto &fGet = attr->as<GAnyClass::GAnyProperty>().fGet;
             if (fGet.isFunction()) {
                 try {
-                    return fGet(inst);
+                    out = fGet(inst);
+                    return true;
                 } catch (GAnyException &e) {
-                    sst << e.what();
+                    if (errors) {
+                        *errors += e.what();
+                    }
                 }
             }
         } else if (attr->isEnum()) {
-            try {
-                return attr->as<GAnyClass::GAnyEnum>().enumObj;
-            } catch (GAnyException &e) {
-                sst << e.what();
-            }
+            out = attr->as<GAnyClass::GAnyEnum>().enumObj;
+            return true;
         } else if (attr->isFunction()) {
             if (attr->as<GAnyFunction>().mIsMethod) {
-                return GAnyCaller(inst, i.toString());
+                out = GAnyCaller(inst, i.toString());
+            } else {
+                out = *attr;
             }
-            return *attr;
+            return true;
         }
         break;
     }
 
     if (mGetItemFn.isFunction()) {
         try {
-            return mGetItemFn(inst, i);
+            out = mGetItemFn(inst, i);
+            return true;
         } catch (GAnyException &e) {
-            sst << e.what();
+            if (errors) {
+                *errors += e.what();
+            }
         }
     }
 
-    GAny r = GAny::undefined();
     for (const GAny &p: mParents) {
-        try {
-            if (p.isClass()) {
-                r = p.as<GAnyClass>().getItem(inst, i);
-            } else {
-                r = p.getItem(0).as<GAnyClass>().getItem(p.getItem(1)(inst), i);
+        const GAnyClass *pClass;
+        GAny pInst;
+        if (p.isClass()) {
+            pClass = &p.as<GAnyClass>();
+            pInst = inst;
+        } else {
+            try {
+                pClass = &p.getItem(0).as<GAnyClass>();
+                pInst = p.getItem(1)(inst);
+            } catch (GAnyException &e) {
+                if (errors) {
+                    *errors += e.what();
+                }
+                continue;
             }
         }
-        catch (GAnyException &e) {
-            sst << e.what();
-            continue;
+        GAny r;
+        if (!errors) {
+            if (!pClass->_tryGetItem(pInst, i, r)) {
+                continue;
+            }
+        } else {
+            std::string pErrors;
+            if (!pClass->_tryGetItem(pInst, i, r, &pErrors)) {
+                *errors += "Class " + pClass->mName + " don't know how to do getItem " + i.toString() + ". \n" + pErrors;
+                continue;
+            }
         }
-
         if (!r.isUndefined()) {
-            return r;
+            out = r;
+            return true;
         }
     }
-
-    throw GAnyException("Class " + mName + " don't know how to do getItem " + i.toString() + ". \n" + sst.str());
-    return GAny::undefined();
+    return false;
 }
 
 inline bool GAnyClass::setItem(const GAny &inst, const GAny &i, const GAny &v)
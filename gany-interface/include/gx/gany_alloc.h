@@ -0,0 +1,627 @@
+/*
+ * Copyright (c) 2022 Gxin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GX_GANY_ALLOC_H
+#define GX_GANY_ALLOC_H
+
+#include "base.h"
+#include "gglobal.h"
+
+#include "gmutex.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+
+GX_NS_BEGIN
+
+/**
+ * @brief Memory source for GAny value allocations (the shared_ptr control block and the value).
+ * GAnyValue::make() uses the GAnyArena active on the calling thread if there is one,
+ * otherwise the resource installed with setDefault(), otherwise std::make_shared.
+ * The default resource is per binary: a plugin module keeps using its own until it installs one.
+ */
+class GAnyMemoryResource
+{
+public:
+    virtual ~GAnyMemoryResource() = default;
+
+    virtual void *allocate(size_t size, size_t align) = 0;
+
+    virtual void deallocate(void *p, size_t size, size_t align) noexcept = 0;
+
+public:
+    static GAnyMemoryResource *getDefault()
+    {
+        return defaultResource().load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Install the resource used for new values, null restores std::make_shared.
+     * Values keep a pointer to the resource they came from, so it must outlive them.
+     */
+    static void setDefault(GAnyMemoryResource *resource)
+    {
+        defaultResource().store(resource, std::memory_order_release);
+    }
+
+private:
+    static std::atomic<GAnyMemoryResource *> &defaultResource()
+    {
+        static std::atomic<GAnyMemoryResource *> sDefault{nullptr};
+        return sDefault;
+    }
+};
+
+
+/**
+ * @brief STL allocator on top of GAnyMemoryResource, used with std::allocate_shared.
+ */
+template<typename T>
+class GAnyResourceAllocator
+{
+public:
+    using value_type = T;
+
+    explicit GAnyResourceAllocator(GAnyMemoryResource *resource) noexcept
+            : mResource(resource)
+    {}
+
+    template<typename U>
+    GAnyResourceAllocator(const GAnyResourceAllocator<U> &other) noexcept
+            : mResource(other.resource())
+    {}
+
+public:
+    T *allocate(size_t n)
+    {
+        return (T *) mResource->allocate(n * sizeof(T), alignof(T));
+    }
+
+    void deallocate(T *p, size_t n) noexcept
+    {
+        mResource->deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    GAnyMemoryResource *resource() const noexcept
+    {
+        return mResource;
+    }
+
+    template<typename U>
+    bool operator==(const GAnyResourceAllocator<U> &rh) const noexcept
+    {
+        return mResource == rh.resource();
+    }
+
+    template<typename U>
+    bool operator!=(const GAnyResourceAllocator<U> &rh) const noexcept
+    {
+        return mResource != rh.resource();
+    }
+
+private:
+    GAnyMemoryResource *mResource;
+};
+
+
+/**
+ * @brief Chunked bump allocator behind GAnyArena.
+ * Only the thread that owns the arena allocates from it, releases may happen on any thread.
+ * The resource counts its live blocks plus one reference for the owning GAnyArena,
+ * all chunks are returned at once when that count drops to zero.
+ */
+class GAnyArenaResource : public GAnyMemoryResource
+{
+public:
+    explicit GAnyArenaResource(size_t chunkSize)
+            : mChunkSize(chunkSize < 256 ? 256 : chunkSize)
+    {}
+
+    ~GAnyArenaResource() override
+    {
+        for (void *chunk: mChunks) {
+            ::operator delete(chunk);
+        }
+    }
+
+    GAnyArenaResource(const GAnyArenaResource &) = delete;
+
+    GAnyArenaResource &operator=(const GAnyArenaResource &) = delete;
+
+public:
+    void *allocate(size_t size, size_t align) override
+    {
+        uintptr_t p = (mCur + (align - 1)) & ~(uintptr_t) (align - 1);
+        if (p + size > mEnd || mCur == 0) {
+            const size_t chunkSize = size + align > mChunkSize ? size + align : mChunkSize;
+            char *chunk = (char *) ::operator new(chunkSize);
+            mChunks.push_back(chunk);
+            mBytesReserved += chunkSize;
+            mCur = (uintptr_t) chunk;
+            mEnd = mCur + chunkSize;
+            p = (mCur + (align - 1)) & ~(uintptr_t) (align - 1);
+        }
+        mCur = p + size;
+        mBytesAllocated += size;
+        mRefs.fetch_add(1, std::memory_order_relaxed);
+        return (void *) p;
+    }
+
+    void deallocate(void *, size_t, size_t) noexcept override
+    {
+        release();
+    }
+
+    /**
+     * @brief Drop one reference (a block or the owning arena), frees all chunks on the last one.
+     */
+    void release() noexcept
+    {
+        if (mRefs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+    size_t chunkCount() const
+    {
+        return mChunks.size();
+    }
+
+    size_t bytesAllocated() const
+    {
+        return mBytesAllocated;
+    }
+
+    size_t bytesReserved() const
+    {
+        return mBytesReserved;
+    }
+
+    /**
+     * @brief Arena active on the calling thread, null if values go to the heap.
+     */
+    static GAnyArenaResource *&current()
+    {
+        static thread_local GAnyArenaResource *sCurrent = nullptr;
+        return sCurrent;
+    }
+
+private:
+    const size_t mChunkSize;
+    std::vector<void *> mChunks;
+    uintptr_t mCur = 0;
+    uintptr_t mEnd = 0;
+    size_t mBytesAllocated = 0;
+    size_t mBytesReserved = 0;
+    std::atomic<size_t> mRefs{1};
+};
+
+
+/**
+ * @brief Request-scoped region for GAny values.
+ * While a GAnyArena is alive, GAny values created on this thread (GAny::create, object(), array(),
+ * parseJson...) are bump-allocated from its chunks instead of one heap allocation each.
+ * The chunks are freed together once the arena is gone and the last value allocated from it is released,
+ * so values that outlive the arena stay valid but keep its memory. Use escape() to copy a value
+ * out to the heap.
+ * Arenas nest and must be destroyed in reverse order of creation on the thread that created them.
+ * Map nodes and string buffers inside values still use the default allocator.
+ */
+class GAnyArena
+{
+public:
+    explicit GAnyArena(size_t chunkSize = 64 * 1024)
+            : mResource(new GAnyArenaResource(chunkSize)),
+              mPrevious(GAnyArenaResource::current())
+    {
+        GAnyArenaResource::current() = mResource;
+    }
+
+    ~GAnyArena()
+    {
+        GAnyArenaResource::current() = mPrevious;
+        mResource->release();
+    }
+
+    GAnyArena(const GAnyArena &) = delete;
+
+    GAnyArena &operator=(const GAnyArena &) = delete;
+
+public:
+    size_t chunkCount() const
+    {
+        return mResource->chunkCount();
+    }
+
+    size_t bytesAllocated() const
+    {
+        return mResource->bytesAllocated();
+    }
+
+    size_t bytesReserved() const
+    {
+        return mResource->bytesReserved();
+    }
+
+    /**
+     * @brief Deep copy a value to the heap, regardless of the arenas active on this thread.
+     * @param value Value to copy (GAny)
+     * @return
+     */
+    template<typename T>
+    static T escape(const T &value)
+    {
+        struct Suspend
+        {
+            GAnyArenaResource *saved = GAnyArenaResource::current();
+
+            Suspend()
+            {
+                GAnyArenaResource::current() = nullptr;
+            }
+
+            ~Suspend()
+            {
+                GAnyArenaResource::current() = saved;
+            }
+        } suspend;
+        return value.clone();
+    }
+
+private:
+    GAnyArenaResource *mResource;
+    GAnyArenaResource *mPrevious;
+};
+
+
+/**
+ * @brief Thread-caching size-class pool for GAny values.
+ * Blocks up to kMaxBlockSize bytes are carved from slabs and recycled through per-thread free lists,
+ * a shared list (under a mutex) only balances blocks between threads in batches.
+ * Slabs are never returned to the system. Larger or over-aligned requests go to operator new.
+ * Install it with GAnyMemoryResource::setDefault(&GAnyPoolResource::instance()).
+ */
+class GAnyPoolResource : public GAnyMemoryResource
+{
+public:
+    static constexpr size_t kClassCount = 10;
+    static constexpr size_t kMaxBlockSize = 256;
+
+    struct ClassStats
+    {
+        size_t blockSize = 0;       ///< 0 for requests larger than kMaxBlockSize
+        int64_t liveCount = 0;      ///< Blocks currently handed out
+        int64_t liveBytes = 0;      ///< Bytes currently handed out (block size for pooled classes)
+        uint64_t totalCount = 0;    ///< Allocations since start
+    };
+
+public:
+    static GAnyPoolResource &instance()
+    {
+        // Never destroyed, values may be released during static destruction.
+        static auto *sPool = new GAnyPoolResource();
+        return *sPool;
+    }
+
+    void *allocate(size_t size, size_t align) override
+    {
+        const size_t cls = classOf(size, align);
+        ThreadCache *cache = threadCache();
+        if (cls == kClassCount) {
+            countAlloc(cache, cls, size);
+            return ::operator new(size, std::align_val_t(align));
+        }
+        countAlloc(cache, cls, blockSize(cls));
+
+        if (cache) {
+            FreeBlock *block = cache->lists[cls];
+            if (!block) {
+                refill(*cache, cls);
+                block = cache->lists[cls];
+            }
+            cache->lists[cls] = block->next;
+            cache->counts[cls]--;
+            return block;
+        }
+
+        GLockerGuard locker(mLock);
+        if (!mShared[cls].head) {
+            carve(cls);
+        }
+        FreeBlock *block = mShared[cls].head;
+        mShared[cls].head = block->next;
+        mShared[cls].count--;
+        return block;
+    }
+
+    void deallocate(void *p, size_t size, size_t align) noexcept override
+    {
+        const size_t cls = classOf(size, align);
+        ThreadCache *cache = threadCache();
+        if (cls == kClassCount) {
+            countFree(cache, cls, size);
+            ::operator delete(p, std::align_val_t(align));
+            return;
+        }
+        countFree(cache, cls, blockSize(cls));
+
+        auto *block = (FreeBlock *) p;
+        if (cache) {
+            block->next = cache->lists[cls];
+            cache->lists[cls] = block;
+            if (++cache->counts[cls] > kMaxCached) {
+                flush(*cache, cls, kBatch);
+            }
+            return;
+        }
+
+        GLockerGuard locker(mLock);
+        block->next = mShared[cls].head;
+        mShared[cls].head = block;
+        mShared[cls].count++;
+    }
+
+    /**
+     * @brief Snapshot of the allocation counters, one entry per size class plus one for large requests.
+     */
+    std::vector<ClassStats> stats() const
+    {
+        std::array<Counters, kClassCount + 1> sum;
+        {
+            GLockerGuard locker(mLock);
+            sum = mRetired;
+            for (const ThreadCache *cache: mCaches) {
+                for (size_t i = 0; i <= kClassCount; i++) {
+                    sum[i].add(cache->counters[i]);
+                }
+            }
+        }
+        std::vector<ClassStats> ret(kClassCount + 1);
+        for (size_t i = 0; i <= kClassCount; i++) {
+            ret[i].blockSize = i < kClassCount ? blockSize(i) : 0;
+            ret[i].totalCount = sum[i].allocCount;
+            ret[i].liveCount = (int64_t) (sum[i].allocCount - sum[i].freeCount);
+            ret[i].liveBytes = (int64_t) (sum[i].allocBytes - sum[i].freeBytes);
+        }
+        return ret;
+    }
+
+    static size_t blockSize(size_t cls)
+    {
+        static const size_t sizes[kClassCount] = {32, 48, 64, 80, 96, 112, 128, 160, 192, 256};
+        return sizes[cls];
+    }
+
+private:
+    static constexpr uint32_t kMaxCached = 256;
+    static constexpr uint32_t kBatch = 64;
+    static constexpr size_t kSlabSize = 64 * 1024;
+
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    struct Counters
+    {
+        uint64_t allocCount = 0;
+        uint64_t freeCount = 0;
+        uint64_t allocBytes = 0;
+        uint64_t freeBytes = 0;
+
+        template<typename C>
+        void add(const C &c)
+        {
+            allocCount += load(c.allocCount);
+            freeCount += load(c.freeCount);
+            allocBytes += load(c.allocBytes);
+            freeBytes += load(c.freeBytes);
+        }
+
+        static uint64_t load(uint64_t v)
+        {
+            return v;
+        }
+
+        static uint64_t load(const std::atomic<uint64_t> &v)
+        {
+            return v.load(std::memory_order_relaxed);
+        }
+    };
+
+    /// Written by the owning thread only, read by stats().
+    struct ThreadCounters
+    {
+        std::atomic<uint64_t> allocCount{0};
+        std::atomic<uint64_t> freeCount{0};
+        std::atomic<uint64_t> allocBytes{0};
+        std::atomic<uint64_t> freeBytes{0};
+    };
+
+    struct ThreadCache
+    {
+        GAnyPoolResource *pool = nullptr;
+        FreeBlock *lists[kClassCount] = {};
+        uint32_t counts[kClassCount] = {};
+        ThreadCounters counters[kClassCount + 1];
+
+        ~ThreadCache()
+        {
+            threadCacheDead() = true;
+            if (pool) {
+                pool->retire(*this);
+            }
+        }
+    };
+
+    struct SharedList
+    {
+        FreeBlock *head = nullptr;
+        size_t count = 0;
+    };
+
+private:
+    GAnyPoolResource()
+    {
+        for (size_t i = 0, cls = 0; i < mClassIndex.size(); i++) {
+            while (blockSize(cls) < i * 16) {
+                cls++;
+            }
+            mClassIndex[i] = (uint8_t) cls;
+        }
+    }
+
+    size_t classOf(size_t size, size_t align) const
+    {
+        if (size > kMaxBlockSize || align > 16) {
+            return kClassCount;
+        }
+        return mClassIndex[(size + 15) / 16];
+    }
+
+    static bool &threadCacheDead()
+    {
+        static thread_local bool sDead = false;
+        return sDead;
+    }
+
+    ThreadCache *threadCache()
+    {
+        if (threadCacheDead()) {
+            return nullptr;
+        }
+        static thread_local ThreadCache sCache;
+        if (!sCache.pool) {
+            sCache.pool = this;
+            GLockerGuard locker(mLock);
+            mCaches.push_back(&sCache);
+        }
+        return &sCache;
+    }
+
+    static void countAlloc(ThreadCache *cache, size_t cls, size_t bytes)
+    {
+        if (cache) {
+            auto &c = cache->counters[cls];
+            c.allocCount.store(c.allocCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            c.allocBytes.store(c.allocBytes.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+        } else {
+            auto &pool = instance();
+            GLockerGuard locker(pool.mLock);
+            pool.mRetired[cls].allocCount++;
+            pool.mRetired[cls].allocBytes += bytes;
+        }
+    }
+
+    static void countFree(ThreadCache *cache, size_t cls, size_t bytes)
+    {
+        if (cache) {
+            auto &c = cache->counters[cls];
+            c.freeCount.store(c.freeCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            c.freeBytes.store(c.freeBytes.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+        } else {
+            auto &pool = instance();
+            GLockerGuard locker(pool.mLock);
+            pool.mRetired[cls].freeCount++;
+            pool.mRetired[cls].freeBytes += bytes;
+        }
+    }
+
+    /// Caller holds mLock.
+    void carve(size_t cls)
+    {
+        const size_t size = blockSize(cls);
+        char *slab = (char *) ::operator new(kSlabSize);
+        mSlabs.push_back(slab);
+        for (size_t offset = 0; offset + size <= kSlabSize; offset += size) {
+            auto *block = (FreeBlock *) (slab + offset);
+            block->next = mShared[cls].head;
+            mShared[cls].head = block;
+            mShared[cls].count++;
+        }
+    }
+
+    void refill(ThreadCache &cache, size_t cls)
+    {
+        GLockerGuard locker(mLock);
+        if (!mShared[cls].head) {
+            carve(cls);
+        }
+        for (uint32_t i = 0; i < kBatch && mShared[cls].head; i++) {
+            FreeBlock *block = mShared[cls].head;
+            mShared[cls].head = block->next;
+            mShared[cls].count--;
+            block->next = cache.lists[cls];
+            cache.lists[cls] = block;
+            cache.counts[cls]++;
+        }
+    }
+
+    void flush(ThreadCache &cache, size_t cls, uint32_t n)
+    {
+        GLockerGuard locker(mLock);
+        for (uint32_t i = 0; i < n && cache.lists[cls]; i++) {
+            FreeBlock *block = cache.lists[cls];
+            cache.lists[cls] = block->next;
+            cache.counts[cls]--;
+            block->next = mShared[cls].head;
+            mShared[cls].head = block;
+            mShared[cls].count++;
+        }
+    }
+
+    void retire(ThreadCache &cache)
+    {
+        for (size_t cls = 0; cls < kClassCount; cls++) {
+            flush(cache, cls, cache.counts[cls]);
+        }
+        GLockerGuard locker(mLock);
+        for (size_t i = 0; i <= kClassCount; i++) {
+            mRetired[i].add(cache.counters[i]);
+        }
+        for (auto it = mCaches.begin(); it != mCaches.end(); ++it) {
+            if (*it == &cache) {
+                mCaches.erase(it);
+                break;
+            }
+        }
+    }
+
+private:
+    std::array<uint8_t, kMaxBlockSize / 16 + 1> mClassIndex{};
+
+    mutable GMutex mLock;
+    SharedList mShared[kClassCount];
+    std::vector<char *> mSlabs;
+    std::vector<ThreadCache *> mCaches;
+    std::array<Counters, kClassCount + 1> mRetired;
+};
+
+GX_NS_END
+
+#endif //GX_GANY_ALLOC_H
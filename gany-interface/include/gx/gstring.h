@@ -27,13 +27,17 @@
 #include "gglobal.h"
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <sstream>
 #include <ostream>
 
 #include <cstring>
+#include <cstdint>
 #include <utility>
 #include <algorithm>
+#include <atomic>
+#include <memory>
 
 #if GX_PLATFORM_WINDOWS
 
@@ -106,7 +110,7 @@ public:
 
     GString(std::string str);
 
-    ~GString() = default;
+    ~GString();
 
 public:
 
@@ -171,6 +175,49 @@ public:
 
     std::vector<GString> split(const GString &cs) const;
 
+    /**
+     * Same as split, but the pieces are views into this string and nothing is copied.
+     * The views are valid until the string is modified or destroyed.
+     * @param cs
+     * @return
+     */
+    std::vector<std::string_view> splitView(const GString &cs) const;
+
+    /**
+     * Call func(std::string_view) for every piece that split would produce, without allocating.
+     * Separators are only matched at character boundaries.
+     * @param cs
+     * @param func
+     */
+    template<typename Func>
+    void tokenize(const GString &cs, Func &&func) const
+    {
+        int32_t begin = 0;
+        const int32_t size = this->count();
+        const int32_t sepSize = cs.count();
+        if (sepSize == 0) {
+            // An empty separator never matches.
+            if (size > 0) {
+                func(std::string_view(this->data(), size));
+            }
+            return;
+        }
+        const auto first = (unsigned char) cs.data()[0];
+        for (int32_t i = 0; i + sepSize <= size;) {
+            const auto c = (unsigned char) this->data()[i];
+            if (c == first && memcmp(this->data() + i, cs.data(), (size_t) sepSize) == 0) {
+                func(std::string_view(this->data() + begin, i - begin));
+                i += sepSize;
+                begin = i;
+            } else {
+                i = c < 0x80 ? i + 1 : _next(i);
+            }
+        }
+        if (begin < size) {
+            func(std::string_view(this->data() + begin, size - begin));
+        }
+    }
+
     /**
      * Forward search, return the starting position of the target string if found, or -1 if not found.
      * @param str
@@ -197,16 +244,43 @@ public:
      */
     uint32_t codepoint(int32_t index) const;
 
+    /**
+     * Check whether the content is well-formed UTF-8 (RFC 3629: no overlong forms,
+     * surrogates or code points above U+10FFFF).
+     * @return
+     */
+    bool isValidUtf8() const;
+
 #ifdef ENABLE_WSTRING
 
     GWString toUtf16() const;
 
 #endif
 
+    /**
+     * Convert to UTF-32, one element per character; element i equals codepoint(i).
+     * @return
+     */
+    std::u32string toU32String() const;
+
+    /**
+     * Convert to UTF-16, characters above U+FFFF are encoded as surrogate pairs.
+     * @return
+     */
+    std::u16string toU16String() const;
+
     GString toUpper() const;
 
     GString toLower() const;
 
+    /**
+     * Unicode simple case folding (CaseFolding.txt, statuses C and S), for caseless comparison.
+     * Unlike toLower, non-ASCII letters are folded as well; each character maps to exactly one
+     * character, so length() does not change, but the byte count may.
+     * @return
+     */
+    GString caseFold() const;
+
     GString &operator=(const GString &bStr);
 
     GString &operator=(GString &&bStr) noexcept;
@@ -295,6 +369,8 @@ public: // static
 
     static GString fromCodepoint(uint32_t codepoint);
 
+    static bool isValidUtf8(const char *str, int32_t size);
+
 private:
     void _build(const char *str, int32_t size = -1);
 
@@ -311,6 +387,36 @@ private:
      */
     int32_t _next(int32_t pIndex) const;
 
+    /**
+     * Number of bytes occupied by a character, derived from its lead byte.
+     * @param lead
+     * @return
+     */
+    static int32_t _charSize(unsigned char lead);
+
+    /**
+     * Number of leading bytes of [str, str + size) that are ASCII, scanned a word at a time.
+     * @param str
+     * @param size
+     * @return
+     */
+    static int32_t _asciiPrefix(const char *str, int32_t size);
+
+    /**
+     * Decode the character of l bytes at u, returning 0 for malformed input.
+     * @param u
+     * @param l
+     * @return
+     */
+    static uint32_t _decode(const char *u, int32_t l);
+
+    /**
+     * Simple case folding of a single code point, the code point itself if it has no folding.
+     * @param codepoint
+     * @return
+     */
+    static uint32_t _foldCase(uint32_t codepoint);
+
     /**
      * Obtain the ASCII character index corresponding to the number of Unicode characters.
      * @param uniCharSize
@@ -324,6 +430,34 @@ private:
      */
     int32_t _checkLength();
 
+    /**
+     * Pure ASCII strings (one byte per character) are indexed by byte directly.
+     * @return
+     */
+    bool _isAscii() const;
+
+    /**
+     * Sparse character index: byte offset of every kIndexStride-th character.
+     * Built on first use and shared by copies, it is dropped whenever the content changes.
+     * @return
+     */
+    const std::vector<int32_t> *_index() const;
+
+    void _dropIndex();
+
+    /**
+     * Character index of the character starting at byte offset pos, or -1 if pos is not a character boundary.
+     * @param pos
+     * @return
+     */
+    int32_t _charIndex(int32_t pos) const;
+
+    /**
+     * Map the ASCII letters in [from, to] by adding delta, leaving multibyte characters untouched.
+     * Byte lengths do not change, so the cached length and index stay valid.
+     */
+    GString _mapAsciiCase(char from, char to, int delta) const;
+
     GString _atChar(int32_t index) const;
 
     void _replace(const GString &before, const GString &after, int32_t offset);
@@ -331,8 +465,12 @@ private:
 private:
     friend struct std::hash<gx::GString>;
 
+    static constexpr int32_t kIndexStride = 64;
+
     std::string mStr;
     int32_t mLength = 0;
+    /// Built on first random access and owned by this value; copies start without one. Immutable once published.
+    mutable std::atomic<const std::vector<int32_t> *> mIndex{nullptr};
 };
 
 inline GString operator+(const GString &a, const GString &b)
@@ -393,18 +531,24 @@ inline GString::GString(const GWString &wstr)
 #endif
 
 inline GString::GString(const GString &str)
-        : mStr(str.mStr)
+        : mStr(str.mStr),
+          mLength(str.mLength)
 {
-    _checkLength();
 }
 
 inline GString::GString(GString &&str) noexcept
         : mStr(std::move(str.mStr)),
-          mLength(str.mLength)
+          mLength(str.mLength),
+          mIndex(str.mIndex.exchange(nullptr, std::memory_order_relaxed))
 {
     str.mLength = 0;
 }
 
+inline GString::~GString()
+{
+    delete mIndex.load(std::memory_order_relaxed);
+}
+
 inline GString::GString(char c)
 {
     _build(c);
@@ -566,19 +710,18 @@ inline GString GString::replace(const GString &before, const GString &after, int
 inline std::vector<GString> GString::split(const gx::GString &cs) const
 {
     std::vector<GString> clips;
-    int32_t begin = 0;
-    for (int32_t i = 0; i < this->count() && i + cs.count() <= this->count();) {
-        if (memcmp(this->data() + i, cs.data(), (size_t) cs.count()) == 0) {
-            clips.emplace_back(this->data() + begin, i - begin);
-            i += cs.count();
-            begin = i;
-        } else {
-            i = _next(i);
-        }
-    }
-    if (begin < this->count()) {
-        clips.emplace_back(this->data() + begin, this->count() - begin);
-    }
+    tokenize(cs, [&clips](std::string_view clip) {
+        clips.emplace_back(clip.data(), (int32_t) clip.size());
+    });
+    return clips;
+}
+
+inline std::vector<std::string_view> GString::splitView(const GString &cs) const
+{
+    std::vector<std::string_view> clips;
+    tokenize(cs, [&clips](std::string_view clip) {
+        clips.push_back(clip);
+    });
     return clips;
 }
 
@@ -590,15 +733,16 @@ inline int32_t GString::indexOf(const GString &str, int32_t from) const
     if (from >= this->length()) {
         return -1;
     }
-    int32_t tSize = from;
-    auto len = (int32_t) count();
-    int32_t i = _seek(tSize);
-    while (i < len) {
-        if (memcmp(this->data() + i, str.data(), str.count()) == 0) {
-            return tSize;
+    if (str.isEmpty()) {
+        return from;
+    }
+    size_t pos = mStr.find(str.mStr, _seek(from));
+    while (pos != std::string::npos) {
+        const int32_t index = _charIndex((int32_t) pos);
+        if (index >= 0) {
+            return index;
         }
-        i = (int32_t) _next(i);
-        ++tSize;
+        pos = mStr.find(str.mStr, pos + 1);
     }
     return -1;
 }
@@ -620,19 +764,17 @@ inline int32_t GString::lastIndexOf(const GString &str, int32_t from) const
     if (targetLen == 0) {
         return -1;
     }
-    GString targetFirstChar = str.at(0);
-    int32_t i = from;
-    while (i >= 0) {
-        while (i >= 0 && this->_atChar(i) != targetFirstChar) {
-            i--;
-        }
-        if (i < 0) {
-            return -1;
+    size_t pos = mStr.rfind(str.mStr, _seek(from));
+    while (pos != std::string::npos) {
+        const int32_t index = _charIndex((int32_t) pos);
+        // The match must also end on the boundary of its targetLen-th character.
+        if (index >= 0 && _charIndex((int32_t) pos + str.count()) == index + targetLen) {
+            return index;
         }
-        if (this->substring(i, targetLen) == str) {
-            return i;
+        if (pos == 0) {
+            break;
         }
-        i--;
+        pos = mStr.rfind(str.mStr, pos - 1);
     }
     return -1;
 }
@@ -641,45 +783,20 @@ inline void GString::swap(GString &b)
 {
     std::swap(this->mStr, b.mStr);
     std::swap(this->mLength, b.mLength);
+    const auto *index = mIndex.load(std::memory_order_relaxed);
+    mIndex.store(b.mIndex.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    b.mIndex.store(index, std::memory_order_relaxed);
 }
 
 inline uint32_t GString::codepoint(int32_t index) const
 {
-    GString c = this->at(index);
-    const char *u = c.data();
-    size_t l = c.count();
-    if (l < 1) {
-        return 0;
-    }
-    unsigned char u0 = u[0];
-    if (u0 >= 0 && u0 <= 127) {
-        return u0;
-    }
-    if (l < 2) {
-        return 0;
-    }
-    unsigned char u1 = u[1];
-    if (u0 >= 192 && u0 <= 223) {
-        return (u0 - 192) * 64 + (u1 - 128);
-    }
-    if ((uint8_t) (u[0]) == 0xed && (u[1] & 0xa0) == 0xa0) {
-        return 0;
-    } //code points, 0xd800 to 0xdfff
-    if (l < 3) {
-        return 0;
-    }
-    unsigned char u2 = u[2];
-    if (u0 >= 224 && u0 <= 239) {
-        return (u0 - 224) * 4096 + (u1 - 128) * 64 + (u2 - 128);
-    }
-    if (l < 4) {
-        return 0;
-    }
-    unsigned char u3 = u[3];
-    if (u0 >= 240 && u0 <= 247) {
-        return (u0 - 240) * 262144 + (u1 - 128) * 4096 + (u2 - 128) * 64 + (u3 - 128);
-    }
-    return 0;
+    const int32_t begin = _seek(index);
+    return _decode(data() + begin, _next(begin) - begin);
+}
+
+inline bool GString::isValidUtf8() const
+{
+    return isValidUtf8(data(), count());
 }
 
 #ifdef ENABLE_WSTRING
@@ -691,30 +808,95 @@ inline GWString GString::toUtf16() const
 
 #endif
 
-inline GString GString::toUpper() const
+inline std::u32string GString::toU32String() const
 {
-    GString temp;
-    for (int32_t i = 0; i < length(); i++) {
-        GString c = at(i);
-        if (c.count() == 1 && c >= 'a' && c <= 'z') {
-            c = char(c.data()[0] - ('a' - 'A'));
+    std::u32string out;
+    out.reserve(length());
+    const char *str = data();
+    const int32_t size = count();
+    int32_t i = 0;
+    while (i < size) {
+        const int32_t ascii = _asciiPrefix(str + i, size - i);
+        for (int32_t e = i + ascii; i < e; i++) {
+            out.push_back((char32_t) (unsigned char) str[i]);
         }
-        temp += c;
+        if (i >= size) {
+            break;
+        }
+        const int32_t l = std::min(_charSize((unsigned char) str[i]), size - i);
+        out.push_back((char32_t) _decode(str + i, l));
+        i += l;
     }
-    return temp;
+    return out;
+}
+
+inline std::u16string GString::toU16String() const
+{
+    std::u16string out;
+    out.reserve(length());
+    const char *str = data();
+    const int32_t size = count();
+    int32_t i = 0;
+    while (i < size) {
+        const int32_t ascii = _asciiPrefix(str + i, size - i);
+        for (int32_t e = i + ascii; i < e; i++) {
+            out.push_back((char16_t) (unsigned char) str[i]);
+        }
+        if (i >= size) {
+            break;
+        }
+        const int32_t l = std::min(_charSize((unsigned char) str[i]), size - i);
+        const uint32_t c = _decode(str + i, l);
+        if (c > 0xFFFF) {
+            out.push_back((char16_t) (0xD800 + ((c - 0x10000) >> 10)));
+            out.push_back((char16_t) (0xDC00 + ((c - 0x10000) & 0x3FF)));
+        } else {
+            out.push_back((char16_t) c);
+        }
+        i += l;
+    }
+    return out;
+}
+
+inline GString GString::toUpper() const
+{
+    return _mapAsciiCase('a', 'z', 'A' - 'a');
 }
 
 inline GString GString::toLower() const
 {
-    GString temp;
-    for (int32_t i = 0; i < length(); i++) {
-        GString c = at(i);
-        if (c.count() == 1 && c >= 'A' && c <= 'Z') {
-            c = char(c.data()[0] + ('a' - 'A'));
+    return _mapAsciiCase('A', 'Z', 'a' - 'A');
+}
+
+inline GString GString::caseFold() const
+{
+    if (_isAscii()) {
+        return toLower();
+    }
+    const char *str = mStr.data();
+    const int32_t size = count();
+    std::string folded;
+    folded.reserve(size);
+    int32_t i = 0;
+    while (i < size) {
+        const int32_t end = i + _asciiPrefix(str + i, size - i);
+        for (; i < end; i++) {
+            folded.push_back(str[i] >= 'A' && str[i] <= 'Z' ? (char) (str[i] + ('a' - 'A')) : str[i]);
+        }
+        if (i >= size) {
+            break;
+        }
+        const int32_t l = std::min(_charSize((unsigned char) str[i]), size - i);
+        const uint32_t cp = _decode(str + i, l);
+        const uint32_t f = cp ? _foldCase(cp) : cp;
+        if (f == cp) {
+            folded.append(str + i, l);
+        } else {
+            folded += fromCodepoint(f).toStdString();
         }
-        temp += c;
+        i += l;
     }
-    return temp;
+    return GString(std::move(folded));
 }
 
 inline GString &GString::operator=(const GString &bStr)
@@ -733,6 +915,9 @@ inline GString &GString::operator=(GString &&bStr) noexcept
     }
     std::swap(this->mStr, bStr.mStr);
     std::swap(this->mLength, bStr.mLength);
+    const auto *index = mIndex.load(std::memory_order_relaxed);
+    mIndex.store(bStr.mIndex.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    bStr.mIndex.store(index, std::memory_order_relaxed);
     return *this;
 }
 
@@ -896,6 +1081,50 @@ inline GString GString::fromCodepoint(uint32_t codepoint)
     return {(const char *) c, (int32_t) strlen((char *) c)};
 }
 
+inline bool GString::isValidUtf8(const char *str, int32_t size)
+{
+    const auto *u = (const unsigned char *) str;
+    int32_t i = 0;
+    while (i < size) {
+        i += _asciiPrefix(str + i, size - i);
+        if (i >= size) {
+            break;
+        }
+        const unsigned char c = u[i];
+        int32_t l;
+        unsigned char lo = 0x80, hi = 0xbf;
+        if (c >= 0xc2 && c <= 0xdf) {
+            l = 2;
+        } else if (c >= 0xe0 && c <= 0xef) {
+            l = 3;
+            if (c == 0xe0) {
+                lo = 0xa0;  // overlong
+            } else if (c == 0xed) {
+                hi = 0x9f;  // surrogates
+            }
+        } else if (c >= 0xf0 && c <= 0xf4) {
+            l = 4;
+            if (c == 0xf0) {
+                lo = 0x90;  // overlong
+            } else if (c == 0xf4) {
+                hi = 0x8f;  // above U+10FFFF
+            }
+        } else {
+            return false;
+        }
+        if (size - i < l || u[i + 1] < lo || u[i + 1] > hi) {
+            return false;
+        }
+        for (int32_t k = 2; k < l; k++) {
+            if ((u[i + k] & 0xc0) != 0x80) {
+                return false;
+            }
+        }
+        i += l;
+    }
+    return true;
+}
+
 //=============== End Static ================//
 
 inline void GString::_build(const char *str, int32_t size)
@@ -909,7 +1138,8 @@ inline void GString::_build(const char *str, int32_t size)
 inline void GString::_build(const GString &str)
 {
     mStr = str.mStr;
-    _checkLength();
+    mLength = str.mLength;
+    _dropIndex();
 }
 
 inline void GString::_build(char c)
@@ -930,60 +1160,285 @@ inline int32_t GString::_next(int32_t pIndex) const
     if (i >= count()) {
         return (int32_t) count();
     }
-    auto c = (unsigned char) mStr[i];
-    int32_t ts;
-    if (c < 0x80) {
-        ts = 1;
-    } else if (c < 0xe0) {
-        ts = 2;
-    } else if (c < 0xf0) {
-        ts = 3;
-    } else if (c < 0xf8) {
-        ts = 4;
-    } else if (c < 0xfc) {
-        ts = 5;
-    } else if (c < 0xfe) {
-        ts = 6;
-    } else {
-        ts = 7;
-    }
-    i += ts;
+    i += _charSize((unsigned char) mStr[i]);
     if (i > this->count()) {
         i = this->count();
     }
     return i;
 }
 
+inline int32_t GString::_charSize(unsigned char lead)
+{
+    // Indexed by lead >> 3; continuation bytes (0x80-0xbf) count as 2 like any lead below 0xe0.
+    static constexpr uint8_t kSizes[32] = {
+            1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+            2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 4, 0
+    };
+    if (lead < 0xf8) {
+        return kSizes[lead >> 3];
+    }
+    return lead < 0xfc ? 5 : (lead < 0xfe ? 6 : 7);
+}
+
+inline int32_t GString::_asciiPrefix(const char *str, int32_t size)
+{
+    int32_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, str + i, sizeof(word));
+        if (word & 0x8080808080808080ull) {
+            break;
+        }
+    }
+    while (i < size && (unsigned char) str[i] < 0x80) {
+        i++;
+    }
+    return i;
+}
+
+inline uint32_t GString::_foldCase(uint32_t codepoint)
+{
+    if (codepoint < 0x80) {
+        return codepoint >= 'A' && codepoint <= 'Z' ? codepoint + ('a' - 'A') : codepoint;
+    }
+    struct FoldRange
+    {
+        uint32_t first;
+        uint32_t last;
+        int32_t delta;
+        uint32_t stride;
+    };
+    // Unicode 14.0 simple case folding of non-ASCII characters, as ranges of characters sharing a delta.
+    // A stride of 2 only folds every other character of the range (upper/lower case pairs).
+    static constexpr FoldRange kRanges[] = {
+            {0x00B5, 0x00B5, 775, 1}, {0x00C0, 0x00D6, 32, 1}, {0x00D8, 0x00DE, 32, 1}, {0x0100, 0x012E, 1, 2},
+            {0x0132, 0x0136, 1, 2}, {0x0139, 0x0147, 1, 2}, {0x014A, 0x0176, 1, 2}, {0x0178, 0x0178, -121, 1},
+            {0x0179, 0x017D, 1, 2}, {0x017F, 0x017F, -268, 1}, {0x0181, 0x0181, 210, 1}, {0x0182, 0x0184, 1, 2},
+            {0x0186, 0x0186, 206, 1}, {0x0187, 0x0187, 1, 1}, {0x0189, 0x018A, 205, 1}, {0x018B, 0x018B, 1, 1},
+            {0x018E, 0x018E, 79, 1}, {0x018F, 0x018F, 202, 1}, {0x0190, 0x0190, 203, 1}, {0x0191, 0x0191, 1, 1},
+            {0x0193, 0x0193, 205, 1}, {0x0194, 0x0194, 207, 1}, {0x0196, 0x0196, 211, 1}, {0x0197, 0x0197, 209, 1},
+            {0x0198, 0x0198, 1, 1}, {0x019C, 0x019C, 211, 1}, {0x019D, 0x019D, 213, 1}, {0x019F, 0x019F, 214, 1},
+            {0x01A0, 0x01A4, 1, 2}, {0x01A6, 0x01A6, 218, 1}, {0x01A7, 0x01A7, 1, 1}, {0x01A9, 0x01A9, 218, 1},
+            {0x01AC, 0x01AC, 1, 1}, {0x01AE, 0x01AE, 218, 1}, {0x01AF, 0x01AF, 1, 1}, {0x01B1, 0x01B2, 217, 1},
+            {0x01B3, 0x01B5, 1, 2}, {0x01B7, 0x01B7, 219, 1}, {0x01B8, 0x01B8, 1, 1}, {0x01BC, 0x01BC, 1, 1},
+            {0x01C4, 0x01C4, 2, 1}, {0x01C5, 0x01C5, 1, 1}, {0x01C7, 0x01C7, 2, 1}, {0x01C8, 0x01C8, 1, 1},
+            {0x01CA, 0x01CA, 2, 1}, {0x01CB, 0x01DB, 1, 2}, {0x01DE, 0x01EE, 1, 2}, {0x01F1, 0x01F1, 2, 1},
+            {0x01F2, 0x01F4, 1, 2}, {0x01F6, 0x01F6, -97, 1}, {0x01F7, 0x01F7, -56, 1}, {0x01F8, 0x021E, 1, 2},
+            {0x0220, 0x0220, -130, 1}, {0x0222, 0x0232, 1, 2}, {0x023A, 0x023A, 10795, 1}, {0x023B, 0x023B, 1, 1},
+            {0x023D, 0x023D, -163, 1}, {0x023E, 0x023E, 10792, 1}, {0x0241, 0x0241, 1, 1}, {0x0243, 0x0243, -195, 1},
+            {0x0244, 0x0244, 69, 1}, {0x0245, 0x0245, 71, 1}, {0x0246, 0x024E, 1, 2}, {0x0345, 0x0345, 116, 1},
+            {0x0370, 0x0372, 1, 2}, {0x0376, 0x0376, 1, 1}, {0x037F, 0x037F, 116, 1}, {0x0386, 0x0386, 38, 1},
+            {0x0388, 0x038A, 37, 1}, {0x038C, 0x038C, 64, 1}, {0x038E, 0x038F, 63, 1}, {0x0391, 0x03A1, 32, 1},
+            {0x03A3, 0x03AB, 32, 1}, {0x03C2, 0x03C2, 1, 1}, {0x03CF, 0x03CF, 8, 1}, {0x03D0, 0x03D0, -30, 1},
+            {0x03D1, 0x03D1, -25, 1}, {0x03D5, 0x03D5, -15, 1}, {0x03D6, 0x03D6, -22, 1}, {0x03D8, 0x03EE, 1, 2},
+            {0x03F0, 0x03F0, -54, 1}, {0x03F1, 0x03F1, -48, 1}, {0x03F4, 0x03F4, -60, 1}, {0x03F5, 0x03F5, -64, 1},
+            {0x03F7, 0x03F7, 1, 1}, {0x03F9, 0x03F9, -7, 1}, {0x03FA, 0x03FA, 1, 1}, {0x03FD, 0x03FF, -130, 1},
+            {0x0400, 0x040F, 80, 1}, {0x0410, 0x042F, 32, 1}, {0x0460, 0x0480, 1, 2}, {0x048A, 0x04BE, 1, 2},
+            {0x04C0, 0x04C0, 15, 1}, {0x04C1, 0x04CD, 1, 2}, {0x04D0, 0x052E, 1, 2}, {0x0531, 0x0556, 48, 1},
+            {0x10A0, 0x10C5, 7264, 1}, {0x10C7, 0x10C7, 7264, 1}, {0x10CD, 0x10CD, 7264, 1}, {0x13F8, 0x13FD, -8, 1},
+            {0x1C80, 0x1C80, -6222, 1}, {0x1C81, 0x1C81, -6221, 1}, {0x1C82, 0x1C82, -6212, 1}, {0x1C83, 0x1C84, -6210, 1},
+            {0x1C85, 0x1C85, -6211, 1}, {0x1C86, 0x1C86, -6204, 1}, {0x1C87, 0x1C87, -6180, 1}, {0x1C88, 0x1C88, 35267, 1},
+            {0x1C90, 0x1CBA, -3008, 1}, {0x1CBD, 0x1CBF, -3008, 1}, {0x1E00, 0x1E94, 1, 2}, {0x1E9B, 0x1E9B, -58, 1},
+            {0x1E9E, 0x1E9E, -7615, 1}, {0x1EA0, 0x1EFE, 1, 2}, {0x1F08, 0x1F0F, -8, 1}, {0x1F18, 0x1F1D, -8, 1},
+            {0x1F28, 0x1F2F, -8, 1}, {0x1F38, 0x1F3F, -8, 1}, {0x1F48, 0x1F4D, -8, 1}, {0x1F59, 0x1F5F, -8, 2},
+            {0x1F68, 0x1F6F, -8, 1}, {0x1F88, 0x1F8F, -8, 1}, {0x1F98, 0x1F9F, -8, 1}, {0x1FA8, 0x1FAF, -8, 1},
+            {0x1FB8, 0x1FB9, -8, 1}, {0x1FBA, 0x1FBB, -74, 1}, {0x1FBC, 0x1FBC, -9, 1}, {0x1FBE, 0x1FBE, -7173, 1},
+            {0x1FC8, 0x1FCB, -86, 1}, {0x1FCC, 0x1FCC, -9, 1}, {0x1FD8, 0x1FD9, -8, 1}, {0x1FDA, 0x1FDB, -100, 1},
+            {0x1FE8, 0x1FE9, -8, 1}, {0x1FEA, 0x1FEB, -112, 1}, {0x1FEC, 0x1FEC, -7, 1}, {0x1FF8, 0x1FF9, -128, 1},
+            {0x1FFA, 0x1FFB, -126, 1}, {0x1FFC, 0x1FFC, -9, 1}, {0x2126, 0x2126, -7517, 1}, {0x212A, 0x212A, -8383, 1},
+            {0x212B, 0x212B, -8262, 1}, {0x2132, 0x2132, 28, 1}, {0x2160, 0x216F, 16, 1}, {0x2183, 0x2183, 1, 1},
+            {0x24B6, 0x24CF, 26, 1}, {0x2C00, 0x2C2F, 48, 1}, {0x2C60, 0x2C60, 1, 1}, {0x2C62, 0x2C62, -10743, 1},
+            {0x2C63, 0x2C63, -3814, 1}, {0x2C64, 0x2C64, -10727, 1}, {0x2C67, 0x2C6B, 1, 2}, {0x2C6D, 0x2C6D, -10780, 1},
+            {0x2C6E, 0x2C6E, -10749, 1}, {0x2C6F, 0x2C6F, -10783, 1}, {0x2C70, 0x2C70, -10782, 1}, {0x2C72, 0x2C72, 1, 1},
+            {0x2C75, 0x2C75, 1, 1}, {0x2C7E, 0x2C7F, -10815, 1}, {0x2C80, 0x2CE2, 1, 2}, {0x2CEB, 0x2CED, 1, 2},
+            {0x2CF2, 0x2CF2, 1, 1}, {0xA640, 0xA66C, 1, 2}, {0xA680, 0xA69A, 1, 2}, {0xA722, 0xA72E, 1, 2},
+            {0xA732, 0xA76E, 1, 2}, {0xA779, 0xA77B, 1, 2}, {0xA77D, 0xA77D, -35332, 1}, {0xA77E, 0xA786, 1, 2},
+            {0xA78B, 0xA78B, 1, 1}, {0xA78D, 0xA78D, -42280, 1}, {0xA790, 0xA792, 1, 2}, {0xA796, 0xA7A8, 1, 2},
+            {0xA7AA, 0xA7AA, -42308, 1}, {0xA7AB, 0xA7AB, -42319, 1}, {0xA7AC, 0xA7AC, -42315, 1}, {0xA7AD, 0xA7AD, -42305, 1},
+            {0xA7AE, 0xA7AE, -42308, 1}, {0xA7B0, 0xA7B0, -42258, 1}, {0xA7B1, 0xA7B1, -42282, 1}, {0xA7B2, 0xA7B2, -42261, 1},
+            {0xA7B3, 0xA7B3, 928, 1}, {0xA7B4, 0xA7C2, 1, 2}, {0xA7C4, 0xA7C4, -48, 1}, {0xA7C5, 0xA7C5, -42307, 1},
+            {0xA7C6, 0xA7C6, -35384, 1}, {0xA7C7, 0xA7C9, 1, 2}, {0xA7D0, 0xA7D0, 1, 1}, {0xA7D6, 0xA7D8, 1, 2},
+            {0xA7F5, 0xA7F5, 1, 1}, {0xAB70, 0xABBF, -38864, 1}, {0xFF21, 0xFF3A, 32, 1}, {0x10400, 0x10427, 40, 1},
+            {0x104B0, 0x104D3, 40, 1}, {0x10570, 0x1057A, 39, 1}, {0x1057C, 0x1058A, 39, 1}, {0x1058C, 0x10592, 39, 1},
+            {0x10594, 0x10595, 39, 1}, {0x10C80, 0x10CB2, 64, 1}, {0x118A0, 0x118BF, 32, 1}, {0x16E40, 0x16E5F, 32, 1},
+            {0x1E900, 0x1E921, 34, 1}
+    };
+    const auto *it = std::upper_bound(std::begin(kRanges), std::end(kRanges), codepoint,
+                                      [](uint32_t c, const FoldRange &r) {
+                                          return c < r.first;
+                                      });
+    if (it == std::begin(kRanges)) {
+        return codepoint;
+    }
+    --it;
+    if (codepoint > it->last || (codepoint - it->first) % it->stride != 0) {
+        return codepoint;
+    }
+    return (uint32_t) ((int32_t) codepoint + it->delta);
+}
+
+inline uint32_t GString::_decode(const char *u, int32_t l)
+{
+    if (l < 1) {
+        return 0;
+    }
+    unsigned char u0 = u[0];
+    if (u0 <= 127) {
+        return u0;
+    }
+    if (l < 2) {
+        return 0;
+    }
+    unsigned char u1 = u[1];
+    if (u0 >= 192 && u0 <= 223) {
+        return (u0 - 192) * 64 + (u1 - 128);
+    }
+    if ((uint8_t) (u[0]) == 0xed && (u[1] & 0xa0) == 0xa0) {
+        return 0;
+    } //code points, 0xd800 to 0xdfff
+    if (l < 3) {
+        return 0;
+    }
+    unsigned char u2 = u[2];
+    if (u0 >= 224 && u0 <= 239) {
+        return (u0 - 224) * 4096 + (u1 - 128) * 64 + (u2 - 128);
+    }
+    if (l < 4) {
+        return 0;
+    }
+    unsigned char u3 = u[3];
+    if (u0 >= 240 && u0 <= 247) {
+        return (u0 - 240) * 262144 + (u1 - 128) * 4096 + (u2 - 128) * 64 + (u3 - 128);
+    }
+    return 0;
+}
+
 inline int32_t GString::_seek(int32_t uniCharSize) const
 {
     if (uniCharSize <= 0) {
         return 0;
     }
+    if (uniCharSize >= mLength) {
+        return this->count();
+    }
+    if (_isAscii()) {
+        return uniCharSize;
+    }
     int32_t tSize = 0;
     int32_t i = 0;
-    for (; i < this->count() && tSize < uniCharSize;) {
+    if (uniCharSize >= kIndexStride) {
+        const auto index = _index();
+        const int32_t slot = uniCharSize / kIndexStride;
+        tSize = slot * kIndexStride;
+        i = (*index)[slot];
+    }
+    while (tSize < uniCharSize) {
         i = _next(i);
         tSize++;
     }
-    if (i > this->count()) {
-        i = this->count();
-    }
     return (int32_t) i;
 }
 
 inline int32_t GString::_checkLength()
 {
+    const char *str = data();
+    const int32_t len = count();
     int32_t tSize = 0;
-    int32_t len = count();
     int32_t i = 0;
     while (i < len) {
-        i = _next(i);
-        ++tSize;
+        const int32_t ascii = _asciiPrefix(str + i, len - i);
+        i += ascii;
+        tSize += ascii;
+        if (i < len) {
+            i = std::min(i + _charSize((unsigned char) str[i]), len);
+            ++tSize;
+        }
     }
     mLength = tSize;
+    _dropIndex();
     return tSize;
 }
 
+inline bool GString::_isAscii() const
+{
+    // Every character takes at least one byte, so equal counts mean one byte per character.
+    return mLength == count();
+}
+
+inline int32_t GString::_charIndex(int32_t pos) const
+{
+    if (pos <= 0) {
+        return pos == 0 ? 0 : -1;
+    }
+    if (pos >= count()) {
+        return pos == count() ? mLength : -1;
+    }
+    if (_isAscii()) {
+        return pos;
+    }
+    int32_t i = 0;
+    int32_t c = 0;
+    if (pos >= kIndexStride) {
+        const auto index = _index();
+        const auto it = std::upper_bound(index->begin(), index->end(), pos) - 1;
+        i = *it;
+        c = (int32_t) (it - index->begin()) * kIndexStride;
+    }
+    while (i < pos) {
+        i = _next(i);
+        c++;
+    }
+    return i == pos ? c : -1;
+}
+
+inline GString GString::_mapAsciiCase(char from, char to, int delta) const
+{
+    GString temp = *this;
+    char *str = &temp.mStr[0];
+    const int32_t size = temp.count();
+    int32_t i = 0;
+    while (i < size) {
+        const int32_t end = i + _asciiPrefix(str + i, size - i);
+        for (; i < end; i++) {
+            if (str[i] >= from && str[i] <= to) {
+                str[i] = (char) (str[i] + delta);
+            }
+        }
+        if (i < size) {
+            i = std::min(i + _charSize((unsigned char) str[i]), size);
+        }
+    }
+    return temp;
+}
+
+inline const std::vector<int32_t> *GString::_index() const
+{
+    const auto *index = mIndex.load(std::memory_order_acquire);
+    if (index) {
+        return index;
+    }
+    auto *built = new std::vector<int32_t>();
+    built->reserve(mLength / kIndexStride + 1);
+    int32_t i = 0;
+    for (int32_t c = 0; c < mLength; c++) {
+        if (c % kIndexStride == 0) {
+            built->push_back(i);
+        }
+        i = _next(i);
+    }
+    // Concurrent readers may build it too, the first one published wins.
+    if (!mIndex.compare_exchange_strong(index, built, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        delete built;
+        return index;
+    }
+    return built;
+}
+
+inline void GString::_dropIndex()
+{
+    delete mIndex.exchange(nullptr, std::memory_order_relaxed);
+}
+
 inline GString GString::_atChar(int32_t index) const
 {
     int32_t i = _seek(index);
@@ -1003,18 +1458,25 @@ inline void GString::_replace(const GString &before, const GString &after, int32
         return;
     }
 
-    auto beginOff = (int32_t) mStr.find(before.mStr, offset);
-    if ((size_t)beginOff == std::string::npos) {
+    size_t pos = mStr.find(before.mStr, offset);
+    if (pos == std::string::npos) {
         return;
     }
 
-    size_t end = beginOff + before.count();
-
-    std::string temp = mStr;
-    mStr = temp.substr(0, beginOff) + after.mStr + temp.substr(end, std::string::npos);
+    // Matches never overlap and replacements are not rescanned, so one left-to-right pass is enough.
+    std::string result;
+    result.reserve(mStr.size());
+    size_t last = 0;
+    do {
+        result.append(mStr, last, pos - last);
+        result.append(after.mStr);
+        last = pos + before.mStr.size();
+        pos = mStr.find(before.mStr, last);
+    } while (pos != std::string::npos);
+    result.append(mStr, last, std::string::npos);
+
+    mStr = std::move(result);
     _checkLength();
-
-    _replace(before, after, beginOff + after.count());
 }
 
 
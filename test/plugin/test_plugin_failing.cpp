@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2022 Gxin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gx/gany_module_def.h>
+#include <gx/gany.h>
+
+
+GANY_MODULE_DEFINE(TestFailing);
+
+PFN_ganyGetEnv pfnGanyGetEnv = nullptr;
+PFN_ganyParseJson pfnGanyParseJson = nullptr;
+PFN_ganyRegisterToEnv pfnGanyRegisterToEnv = nullptr;
+PFN_ganyClassInstance pfnGanyClassInstance = nullptr;
+
+class TestFailingProbe
+{
+};
+
+static int32_t sRegisterCalls = 0;
+
+/**
+ * Module whose registration always fails, it counts how often it was asked to register.
+ */
+int32_t GX_API_CALL RegisterTestFailing(int64_t /*versionCode*/, PFN_ganyGetEnv pfnGetEnv, PFN_ganyParseJson pfnParseJson,
+                                        PFN_ganyRegisterToEnv pfnRegisterToEnv, PFN_ganyClassInstance pfnClassInstance)
+{
+    using namespace gx;
+    pfnGanyGetEnv = pfnGetEnv;
+    pfnGanyParseJson = pfnParseJson;
+    pfnGanyRegisterToEnv = pfnRegisterToEnv;
+    pfnGanyClassInstance = pfnClassInstance;
+
+    if (sRegisterCalls++ == 0) {
+        Class<TestFailingProbe>("TestFailingNs", "Probe", "Reports how often the failing module was registered.")
+                .staticFunc("registerCalls", []() {
+                    return sRegisterCalls;
+                });
+    }
+    return 1;
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2022 Gxin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <gx/gany_core.h>
+
+
+using namespace gx;
+
+TEST(GAnyArenaTest, ValuesComeFromArena)
+{
+    GAny escaped;
+    GAny kept;
+    {
+        GAnyArena arena(4096);
+        EXPECT_EQ(arena.chunkCount(), 0);
+
+        GAny obj = GAny::parseJson(R"({"items":[1,2,3],"name":"arena","nested":{"ok":true}})");
+        ASSERT_TRUE(obj.isObject());
+        EXPECT_GE(arena.chunkCount(), 1);
+        const size_t used = arena.bytesAllocated();
+        EXPECT_GT(used, 0);
+
+        GAny local = GAny::array();
+        for (int i = 0; i < 1000; i++) {
+            local.pushBack(i);
+        }
+        EXPECT_GT(arena.chunkCount(), 1);
+        EXPECT_LE(arena.bytesAllocated(), arena.bytesReserved());
+
+        const size_t beforeEscape = arena.bytesAllocated();
+        escaped = GAnyArena::escape(obj);
+        EXPECT_EQ(arena.bytesAllocated(), beforeEscape);
+
+        kept = obj["nested"];
+    }
+
+    // Values that outlive the arena keep its chunks alive.
+    EXPECT_TRUE(kept["ok"].toBool());
+    EXPECT_EQ(escaped["items"].size(), 3);
+    EXPECT_EQ(escaped["name"].toString(), "arena");
+    EXPECT_EQ(escaped, GAny::parseJson(R"({"items":[1,2,3],"name":"arena","nested":{"ok":true}})"));
+}
+
+TEST(GAnyArenaTest, Nesting)
+{
+    GAnyArena outer;
+    GAny a = GAny::object();
+    const size_t outerUsed = outer.bytesAllocated();
+    {
+        GAnyArena inner;
+        GAny b = GAny::object();
+        EXPECT_GT(inner.bytesAllocated(), 0);
+        EXPECT_EQ(outer.bytesAllocated(), outerUsed);
+    }
+    GAny c = GAny::array();
+    EXPECT_GT(outer.bytesAllocated(), outerUsed);
+}
+
+static int64_t poolLiveCount()
+{
+    int64_t count = 0;
+    for (const auto &s: GAnyPoolResource::instance().stats()) {
+        count += s.liveCount;
+    }
+    return count;
+}
+
+TEST(GAnyPoolTest, RecyclesAndCounts)
+{
+    auto &pool = GAnyPoolResource::instance();
+    GAnyMemoryResource::setDefault(&pool);
+
+    const int64_t before = poolLiveCount();
+    {
+        GAny arr = GAny::array();
+        for (int i = 0; i < 1000; i++) {
+            GAny obj = GAny::object();
+            obj["v"] = i;
+            arr.pushBack(obj);
+        }
+        EXPECT_GE(poolLiveCount() - before, 2001);
+
+        bool hasObjectClass = false;
+        for (const auto &s: pool.stats()) {
+            if (s.blockSize != 0 && s.liveCount >= 1000) {
+                hasObjectClass = true;
+                EXPECT_EQ(s.liveBytes, s.liveCount * (int64_t) s.blockSize);
+            }
+        }
+        EXPECT_TRUE(hasObjectClass);
+        EXPECT_EQ(arr[999]["v"].toInt32(), 999);
+    }
+    EXPECT_EQ(poolLiveCount(), before);
+
+    // Values released on another thread go back to that thread's cache.
+    std::vector<GAny> values;
+    for (int i = 0; i < 5000; i++) {
+        values.emplace_back(GAny((double) i));
+    }
+    std::thread worker([&values]() {
+        values.clear();
+        for (int i = 0; i < 5000; i++) {
+            GAny tmp = GAny::array();
+        }
+    });
+    worker.join();
+    EXPECT_EQ(poolLiveCount(), before);
+
+    GAnyMemoryResource::setDefault(nullptr);
+    GAny heap = GAny::object();
+    EXPECT_EQ(poolLiveCount(), before);
+}
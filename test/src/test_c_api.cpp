@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2022 Gxin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <gx/gany_core.h>
+#include <gx/gany_c_api.h>
+#include <gx/reg_gany_c_module.h>
+
+#include <thread>
+
+
+using namespace gx;
+
+namespace
+{
+
+class GAnyCApiTest : public ::testing::Test
+{
+protected:
+    static void SetUpTestSuite()
+    {
+        GANY_IMPORT_MODULE(GAnyC);
+    }
+};
+
+}
+
+TEST_F(GAnyCApiTest, HandlesAreCheckedAndRecycled)
+{
+    GAnyPtr a = ganyCreateInt32(42);
+    ASSERT_NE(a, 0);
+    EXPECT_EQ(ganyToInt32(a), 42);
+
+    ganyDestroy(a);
+    // The stale handle is detected instead of touching freed memory.
+    EXPECT_FALSE(ganyIsInt32(a));
+    ganyDestroy(a);
+
+    // The slot is reused under a new generation, so the old handle stays invalid.
+    GAnyPtr b = ganyCreateString("reused");
+    EXPECT_NE(a, b);
+    EXPECT_FALSE(ganyIsInt32(a));
+    EXPECT_TRUE(ganyIsString(b));
+    ganyDestroy(b);
+}
+
+TEST_F(GAnyCApiTest, ReleaseAllInScope)
+{
+    std::vector<GAnyPtr> handles;
+    for (int32_t i = 0; i < 3000; i++) {
+        handles.push_back(ganyCreateInt32(i));
+    }
+    EXPECT_EQ(ganyToInt32(handles[2999]), 2999);
+    // Handles of the default scope are released per thread.
+    GAnyPtr other = 0;
+    std::thread([&other]() { other = ganyCreateInt32(-1); }).join();
+    EXPECT_GE(ganyReleaseAll(0), 3000);
+    EXPECT_FALSE(ganyIsInt32(handles[0]));
+    EXPECT_FALSE(ganyIsInt32(handles[2999]));
+    EXPECT_TRUE(ganyIsInt32(other));
+    ganyDestroy(other);
+
+    const int32_t scope = ganyPushScope();
+    GAnyPtr a = ganyCreateInt32(1);
+    ganyDestroy(ganyCreateInt32(2));
+    EXPECT_EQ(ganyReleaseAll(scope), 1);
+    EXPECT_FALSE(ganyIsInt32(a));
+    GAnyPtr b = ganyCreateInt32(3);
+    EXPECT_EQ(ganyPopScope(), 1);
+    EXPECT_FALSE(ganyIsInt32(b));
+    EXPECT_EQ(ganyReleaseAll(scope), 0);
+}
+
+TEST_F(GAnyCApiTest, ScopesReleaseUnlessEscaped)
+{
+    GAnyPtr outer = 0;
+    GAnyPtr kept = 0;
+    GAnyPtr temp = 0;
+
+    ganyPushScope();
+    outer = ganyCreateObject();
+    {
+        ganyPushScope();
+        GAnyPtr key = ganyCreateString("k");
+        temp = ganyCreateInt32(1);
+        ganySetItem(outer, key, temp);
+        kept = ganyEscape(ganyGetItem(outer, key));
+        ganyDestroy(key);  // Released early; popping must not trip over it.
+        EXPECT_EQ(ganyPopScope(), 1);
+    }
+    EXPECT_FALSE(ganyIsInt32(temp));
+    EXPECT_TRUE(ganyIsInt32(kept));
+    EXPECT_TRUE(ganyIsObject(outer));
+    EXPECT_EQ(ganyPopScope(), 2);
+    EXPECT_FALSE(ganyIsInt32(kept));
+    EXPECT_FALSE(ganyIsObject(outer));
+
+    EXPECT_EQ(ganyPopScope(), 0);
+
+    // Escaping from the outermost scope moves the handle to the default scope.
+    ganyPushScope();
+    GAnyPtr survivor = ganyEscape(ganyCreateInt64(7));
+    ganyPopScope();
+    EXPECT_EQ(ganyToInt64(survivor), 7);
+    ganyDestroy(survivor);
+
+    // Only handles of the innermost scope move, escaping anything else leaves its owner alone.
+    GAnyPtr owned = ganyCreateInt32(9);
+    ganyPushScope();
+    ganyPushScope();
+    EXPECT_EQ(ganyEscape(owned), owned);
+    GAnyPtr twice = ganyEscape(ganyEscape(ganyCreateInt32(10)));
+    EXPECT_EQ(ganyPopScope(), 0);
+    EXPECT_EQ(ganyPopScope(), 1);
+    EXPECT_FALSE(ganyIsInt32(twice));
+    EXPECT_EQ(ganyToInt32(owned), 9);
+    ganyDestroy(owned);
+}
+
+TEST_F(GAnyCApiTest, ReturnedStrings)
+{
+    GAnyPtr obj = ganyParseJson(R"({"a":[1,2]})");
+    GAnyString json = ganyToJsonString(obj, -1);
+    GAnyString str = ganyToString(obj);
+    EXPECT_STREQ(json, R"({"a":[1,2]})");
+    // Freed in any order.
+    ganyFreeString(json);
+    ganyFreeString(str);
+
+    GAnyPtr hello = ganyCreateString("hello world");
+    char buf[6];
+    EXPECT_EQ(ganyToStringBuf(hello, buf, sizeof(buf)), 11u);
+    EXPECT_STREQ(buf, "hello");
+    char big[32];
+    EXPECT_EQ(ganyToStringBuf(hello, big, sizeof(big)), 11u);
+    EXPECT_STREQ(big, "hello world");
+    EXPECT_EQ(ganyToStringBuf(hello, nullptr, 0), 11u);
+
+    ganyDestroy(hello);
+    ganyDestroy(obj);
+}
+
+namespace
+{
+
+bool sArgsBorrowed = true;
+GAnyPtr sLastBorrowed = 0;
+
+void GX_API_PTR sumProxy(CAnyFuncPtr funcPtr, const GAnyPtr *args, int32_t argc, GAnyPtr retSlot)
+{
+    int64_t sum = funcPtr;
+    for (int32_t i = 0; i < argc; i++) {
+        sArgsBorrowed = sArgsBorrowed && args[i] < 0;
+        sum += ganyToInt64(args[i]);
+    }
+    ganyAssignInt64(retSlot, sum);
+    if (argc > 0) {
+        // Rejected, the caller's argument stays untouched.
+        ganyAssignInt64(args[0], -1);
+    }
+    sLastBorrowed = argc > 0 ? args[0] : 0;
+}
+
+}
+
+TEST_F(GAnyCApiTest, BorrowedFunctionProxy)
+{
+    ganySetFunctionBorrowedProxy(sumProxy);
+
+    GAnyPtr func = ganyCreateFunction(100);
+    GAnyPtr args[] = {ganyCreateInt32(1), ganyCreateInt64(2)};
+    GAnyPtr ret = ganyCallFunction(func, args, 2);
+    EXPECT_EQ(ganyToInt64(ret), 103);
+    EXPECT_TRUE(sArgsBorrowed);
+    EXPECT_EQ(ganyToInt32(args[0]), 1);
+
+    // Borrowed handles die with the call, and other negative values are never taken as pointers.
+    ASSERT_LT(sLastBorrowed, 0);
+    EXPECT_FALSE(ganyIsInt32(sLastBorrowed));
+    EXPECT_FALSE(ganyIsInt32(-1));
+    EXPECT_FALSE(ganyIsInt32(INT64_MIN | (int64_t) args[0]));
+
+    ganySetFunctionBorrowedProxy(nullptr);
+    ganyDestroy(ret);
+    ganyDestroy(args[0]);
+    ganyDestroy(args[1]);
+    ganyDestroy(func);
+}
+
+TEST_F(GAnyCApiTest, BatchAccess)
+{
+    ganyPushScope();
+
+    GAnyPtr record = ganyParseJson(R"({"id":7,"name":"n","score":1.5})");
+    GAnyPtr keys[] = {ganyCreateString("id"), ganyCreateString("score"), ganyCreateString("missing")};
+    GAnyPtr values[3] = {};
+    EXPECT_EQ(ganyGetItems(record, keys, 3, values), 3);
+    EXPECT_EQ(ganyToInt32(values[0]), 7);
+    EXPECT_DOUBLE_EQ(ganyToDouble(values[1]), 1.5);
+    EXPECT_TRUE(ganyIsUndefined(values[2]));
+
+    GAnyPtr newValues[] = {ganyCreateInt32(8), ganyCreateDouble(2.5), ganyCreateBool(true)};
+    EXPECT_EQ(ganySetItems(record, keys, newValues, 3), 3);
+    GAnyString json = ganyToJsonString(record, -1);
+    EXPECT_EQ(GAny::parseJson(json), GAny::parseJson(R"({"id":8,"name":"n","score":2.5,"missing":true})"));
+    ganyFreeString(json);
+
+    GAnyPtr numbers = ganyParseJson("[1, 2.5, 3, 4]");
+    int64_t ints[8] = {};
+    double doubles[3] = {};
+    EXPECT_EQ(ganyToInt64Array(numbers, ints, 8), 4);
+    EXPECT_EQ(ints[1], 2);
+    EXPECT_EQ(ints[3], 4);
+    EXPECT_EQ(ganyToDoubleArray(numbers, doubles, 3), 3);
+    EXPECT_DOUBLE_EQ(doubles[1], 2.5);
+
+    GAnyPtr arrays[] = {ganyParseJson("[1, 2]"), ganyParseJson("[]"), ganyCreateInt32(0)};
+    GAnyPtr insertArgs[] = {ganyCreateInt32(0), ganyCreateString("head")};
+    GAnyPtr outs[3] = {};
+    EXPECT_EQ(ganyCallMethodBatch(arrays, 3, "insert", insertArgs, 2, outs), 2);
+    EXPECT_EQ(ganyLength(arrays[0]), 3);
+    EXPECT_EQ(ganyLength(arrays[1]), 1);
+    EXPECT_TRUE(ganyIsUndefined(outs[2]));
+
+    ganyPopScope();
+}
+
+TEST_F(GAnyCApiTest, TypedBuffers)
+{
+    ganyPushScope();
+
+    const int32_t ints[] = {3, -1, 4, 1, 5};
+    GAnyPtr arr = ganyCreateArrayFromInt32s(ints, 5);
+    ASSERT_TRUE(ganyIsArray(arr));
+    EXPECT_EQ(ganyLength(arr), 5);
+
+    double doubles[5] = {};
+    EXPECT_EQ(ganyCopyToBuffer(arr, GANY_BUFFER_DOUBLE, doubles, 5), 5);
+    EXPECT_DOUBLE_EQ(doubles[1], -1.0);
+    int8_t bytes[3] = {};
+    EXPECT_EQ(ganyCopyToBuffer(arr, GANY_BUFFER_INT8, bytes, 3), 3);
+    EXPECT_EQ(bytes[2], 4);
+
+    const double ds[] = {0.5, 1.25};
+    float fs[2] = {};
+    EXPECT_EQ(ganyCopyToBuffer(ganyCreateArrayFromDoubles(ds, 2), GANY_BUFFER_FLOAT, fs, 2), 2);
+    EXPECT_FLOAT_EQ(fs[1], 1.25f);
+
+    const char *names[] = {"a", nullptr, "c"};
+    GAnyPtr strs = ganyCreateArrayFromStrings(names, 3);
+    GAnyString json = ganyToJsonString(strs, -1);
+    EXPECT_STREQ(json, R"(["a",null,"c"])");
+    ganyFreeString(json);
+
+    int marker = 0;
+    void *ptrs[] = {&marker};
+    void *back[1] = {};
+    EXPECT_EQ(ganyCopyToBuffer(ganyCreateArrayFromPointers(ptrs, 1), GANY_BUFFER_POINTER, back, 1), 1);
+    EXPECT_EQ(back[0], &marker);
+
+    ganyPopScope();
+}
+
+TEST_F(GAnyCApiTest, CachedMethodHandles)
+{
+    ganyPushScope();
+
+    GAnyPtr a = ganyParseJson("[1]");
+    GAnyPtr b = ganyParseJson("[]");
+    GAnyPtr insert = ganyLookupMethod(a, "insert");
+    ASSERT_NE(insert, 0);
+    EXPECT_EQ(ganyLookupMethod(a, "noSuchMethod"), 0);
+
+    GAnyPtr args[] = {ganyCreateInt32(0), ganyCreateString("x")};
+    for (int i = 0; i < 3; i++) {
+        ganyInvokeMethod(insert, a, args, 2);
+    }
+    ganyInvokeMethod(insert, b, args, 2);
+    EXPECT_EQ(ganyLength(a), 4);
+    EXPECT_EQ(ganyLength(b), 1);
+
+    // Not a method handle.
+    EXPECT_TRUE(ganyIsUndefined(ganyInvokeMethod(a, a, args, 2)));
+
+    ganyPopScope();
+}
+
+TEST_F(GAnyCApiTest, TryVariantsReportStatus)
+{
+    ganyPushScope();
+
+    GAnyPtr obj = ganyParseJson(R"({"a":1})");
+    GAnyPtr a = ganyCreateString("a");
+    GAnyPtr b = ganyCreateString("b");
+    GAnyPtr out = -1;
+    EXPECT_EQ(ganyTryGetItem(obj, a, &out), GANY_STATUS_OK);
+    EXPECT_EQ(ganyToInt32(out), 1);
+    EXPECT_EQ(ganyTryGetItem(obj, b, &out), GANY_STATUS_NOT_FOUND);
+    EXPECT_EQ(out, 0);
+
+    GAnyPtr arr = ganyCreateArray();
+    EXPECT_EQ(ganyTryCallMethod(arr, "noSuchMethod", nullptr, 0, &out), GANY_STATUS_NOT_FOUND);
+    GAnyPtr args[] = {ganyCreateInt32(0), a};
+    EXPECT_EQ(ganyTryCallMethod(arr, "insert", args, 2, &out), GANY_STATUS_OK);
+    EXPECT_EQ(ganyLength(arr), 1);
+
+    EXPECT_EQ(ganyTryGetItem(obj, 12345, &out), GANY_STATUS_ERROR);
+    EXPECT_STRNE(ganyLastError(), "");
+
+    ganyPopScope();
+}
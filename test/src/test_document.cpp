@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2022 Gxin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <gx/gany_core.h>
+#include <gx/gany_document.h>
+
+#include <cstdio>
+#include <set>
+
+
+using namespace gx;
+
+static GAny makeDocumentSource()
+{
+    return GAny::parseJson(R"({
+        "name": "table",
+        "version": 3,
+        "ratio": 0.25,
+        "enabled": true,
+        "empty": null,
+        "big": 9007199254740993,
+        "rows": [
+            {"id": 1, "tags": ["a", "b"]},
+            {"id": 2, "tags": []}
+        ],
+        "meta": {"owner": "gx", "nested": {"depth": 2}}
+    })");
+}
+
+TEST(GAnyDocumentTest, EncodeDecode)
+{
+    GAny src = makeDocumentSource();
+    const GAny doc = GAnyDocument::decode(GAnyDocument::encode(src));
+
+    ASSERT_TRUE(doc.is("GAnyDocumentNode"));
+    EXPECT_FALSE(doc.isObject());
+    EXPECT_EQ(doc.length(), src.length());
+
+    EXPECT_EQ(doc["name"].toString(), "table");
+    EXPECT_EQ(doc["version"].toInt32(), 3);
+    EXPECT_DOUBLE_EQ(doc["ratio"].toDouble(), 0.25);
+    EXPECT_TRUE(doc["enabled"].toBool());
+    EXPECT_TRUE(doc["empty"].isNull());
+    EXPECT_EQ(doc["big"].toInt64(), 9007199254740993LL);
+    EXPECT_TRUE(doc["missing"].isUndefined());
+
+    EXPECT_EQ(doc["rows"].length(), 2);
+    EXPECT_EQ(doc["rows"][1]["id"].toInt32(), 2);
+    EXPECT_EQ(doc["rows"][0]["tags"][1].toString(), "b");
+    EXPECT_TRUE(doc["rows"][5].isUndefined());
+    EXPECT_EQ(doc["meta.nested.depth"].toInt32(), 2);
+
+    EXPECT_EQ(GAny::parseJson(doc.toJsonString()), src);
+    EXPECT_TRUE(GAnyDocument::decode("not a document").isUndefined());
+}
+
+TEST(GAnyDocumentTest, Iteration)
+{
+    const GAny doc = GAnyDocument::decode(GAnyDocument::encode(makeDocumentSource()));
+
+    std::vector<std::string> keys;
+    for (auto it = doc["meta"].iterator(); it.hasNext();) {
+        keys.push_back(it.next().first.toString());
+    }
+    EXPECT_EQ(keys, std::vector<std::string>({"nested", "owner"}));
+
+    int32_t idSum = 0;
+    for (auto it = doc["rows"].iterator(); it.hasNext();) {
+        idSum += it.next().second.getItem("id").toInt32();
+    }
+    EXPECT_EQ(idSum, 3);
+}
+
+TEST(GAnyDocumentTest, MaterializeOnMutationAndClone)
+{
+    const GAny doc = GAnyDocument::decode(GAnyDocument::encode(makeDocumentSource()));
+
+    GAny meta = doc["meta"];
+    meta.setItem("owner", "gany");
+    meta.setItem("extra", 1);
+    EXPECT_EQ(meta.getItem("owner").toString(), "gany");
+    EXPECT_EQ(meta.getItem("extra").toInt32(), 1);
+    EXPECT_EQ(meta.length(), 3);
+    EXPECT_EQ(meta.getItem("nested.depth").toInt32(), 2);
+    EXPECT_EQ(doc["meta"]["owner"].toString(), "gany");
+
+    GAny copy = doc.clone();
+    EXPECT_TRUE(copy.isObject());
+    EXPECT_TRUE(copy["rows"].isArray());
+    EXPECT_TRUE(copy["rows"][0]["tags"].isArray());
+    EXPECT_EQ(copy["rows"][0]["tags"][0].toString(), "a");
+}
+
+TEST(GAnyDocumentTest, IterationAfterMutation)
+{
+    const GAny doc = GAnyDocument::decode(GAnyDocument::encode(makeDocumentSource()));
+
+    // Mutating through temporaries must stick, children are only cached weakly until then.
+    GAny(doc["meta"]["nested"]).setItem("extra", true);
+    EXPECT_TRUE(doc["meta"]["nested"]["extra"].toBool());
+
+    GAny meta = doc["meta"];
+    auto started = meta.iterator();
+    ASSERT_TRUE(started.hasNext());
+    EXPECT_EQ(started.next().first.toString(), "nested");
+
+    meta.delItem("owner");
+    meta.setItem("added", 1);
+
+    std::set<std::string> keys;
+    for (auto it = meta.iterator(); it.hasNext();) {
+        keys.insert(it.next().first.toString());
+    }
+    EXPECT_EQ(keys, std::set<std::string>({"added", "nested"}));
+
+    std::set<std::string> rest;
+    while (started.hasNext()) {
+        rest.insert(started.next().first.toString());
+    }
+    EXPECT_EQ(rest, std::set<std::string>({"added"}));
+
+    GAny rows = doc["rows"];
+    rows.delItem(0);
+    int32_t idSum = 0;
+    for (auto it = rows.iterator(); it.hasNext();) {
+        idSum += it.next().second.getItem("id").toInt32();
+    }
+    EXPECT_EQ(idSum, 2);
+}
+
+TEST(GAnyDocumentTest, LoadMappedFile)
+{
+    const std::string path = "test_gany_document.gadoc";
+    GAny src = makeDocumentSource();
+    ASSERT_TRUE(GAnyDocument::save(src, path));
+
+    {
+        const GAny doc = GAnyDocument::load(path);
+        EXPECT_EQ(doc["rows"][0]["id"].toInt32(), 1);
+        EXPECT_EQ(doc["meta"]["owner"].toString(), "gx");
+        EXPECT_EQ(doc.clone(), src);
+    }
+
+    GAny scalar = GAnyDocument::decode(GAnyDocument::encode(GAny("text")));
+    EXPECT_EQ(scalar.toString(), "text");
+
+    std::remove(path.c_str());
+    EXPECT_TRUE(GAnyDocument::load(path).isUndefined());
+}
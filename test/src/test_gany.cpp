@@ -23,8 +23,11 @@
 #include <gtest/gtest.h>
 
 #include <gx/gany_core.h>
+#include <gx/gany_json.h>
 #include <gx/gany.h>
 
+#include <stdexcept>
+
 
 using namespace gx;
 
@@ -203,6 +206,127 @@ TEST(GAnyTest, NestedJson)
     EXPECT_EQ(obj["person"]["address"]["zipcode"].as<std::string>(), "10001");
 }
 
+TEST(GAnyTest, JsonRecordsAndNumbers)
+{
+    std::string jsonStr = "[";
+    for (int i = 0; i < 100; i++) {
+        jsonStr += (i ? "," : "") + std::string(R"({"id":)") + std::to_string(i)
+                   + R"(,"name":"n)" + std::to_string(i) + R"(","a_rather_long_key_name":null})";
+    }
+    jsonStr += "]";
+    const GAny arr = GAny::parseJson(jsonStr);
+    ASSERT_TRUE(arr.isArray());
+    ASSERT_EQ(arr.size(), 100);
+    EXPECT_EQ(arr[99]["id"].as<int32_t>(), 99);
+    EXPECT_EQ(arr[42]["name"].as<std::string>(), "n42");
+    EXPECT_TRUE(arr[7]["a_rather_long_key_name"].isNull());
+
+    const GAny nums = GAny::parseJson(
+            R"({"i":-5,"u":3000000000,"l":-5000000000,"ul":18446744073709551615,"d":0.5,"k":1,"k":2,"s":"a\u0000b"})");
+    EXPECT_EQ(nums["i"].as<int32_t>(), -5);
+    EXPECT_EQ(nums["u"].as<uint32_t>(), 3000000000u);
+    EXPECT_EQ(nums["l"].as<int64_t>(), -5000000000ll);
+    EXPECT_EQ(nums["ul"].as<uint64_t>(), 18446744073709551615ull);
+    EXPECT_DOUBLE_EQ(nums["d"].as<double>(), 0.5);
+    EXPECT_EQ(nums["k"].as<int32_t>(), 2);
+    EXPECT_EQ(nums["s"].as<std::string>().size(), 3);
+
+    EXPECT_TRUE(GAny::parseJson("{\"broken\":").isObject());
+}
+
+TEST(GAnyTest, JsonInternedKeys)
+{
+    const std::string jsonStr = R"([{"id":1,"name":"a","meta":{"k":true}},{"id":2,"name":"b","meta":{"k":false}}])";
+    const GAny records = GAnyJson::parseInterned(jsonStr);
+    ASSERT_TRUE(records.isArray());
+    ASSERT_TRUE(records[0].is("GAnyInternedObject"));
+    EXPECT_EQ(records[1]["id"].toInt32(), 2);
+    EXPECT_EQ(records[1]["name"].toString(), "b");
+    EXPECT_FALSE(records[1]["meta.k"].toBool());
+    EXPECT_TRUE(records[0]["missing"].isUndefined());
+    EXPECT_EQ(GAny::parseJson(records.toJsonString()), GAny::parseJson(jsonStr));
+    EXPECT_EQ(GAnyJson::parseInterned(R"({"k":1,"k":2})").getItem("k").toInt32(), 2);
+    EXPECT_TRUE(GAnyJson::parseInterned("{\"broken\":").isObject());
+
+    GAny record = records[0];
+    record.setItem("extra", 3);
+    record.delItem("name");
+    record.setItem("id", 10);
+    std::vector<std::string> keys;
+    for (auto it = record.iterator(); it.hasNext();) {
+        keys.push_back(it.next().first.toString());
+    }
+    EXPECT_EQ(keys, std::vector<std::string>({"id", "meta", "extra"}));
+    EXPECT_EQ(records[0]["id"].toInt32(), 10);
+    EXPECT_TRUE(record.toObject().isObject());
+    EXPECT_EQ(record.toObject()["extra"].toInt32(), 3);
+}
+
+TEST(GAnyTest, CallArgumentsAreNotCopied)
+{
+    GAny useCount = [](const GAny &v) {
+        return (int64_t) v.value().use_count();
+    };
+    GAny value = 42;
+    EXPECT_EQ(useCount(value).toInt64(), 1);
+    EXPECT_EQ(useCount(GAny(1)).toInt64(), 1);
+
+    GAny concat = [](const std::string &a, const std::string &b, int32_t c) {
+        return a + b + std::to_string(c);
+    };
+    std::string s = "b";
+    EXPECT_EQ(concat("a", s, 3).toString(), "ab3");
+    EXPECT_EQ(concat(std::string("x"), GAny("y"), value).toString(), "xy42");
+}
+
+TEST(GAnyTest, LookupsShareValues)
+{
+    EXPECT_EQ(GAny::undefined().value(), GAny().value());
+
+    GAny item = GAny::object();
+    item["x"] = 1;
+    GAny obj = GAny::object();
+    obj["a"] = item;
+    GAny arr = GAny::array();
+    arr.pushBack(item);
+    {
+        GAny a = obj.getItem("a");
+        GAny b = arr.getItem(0);
+        EXPECT_EQ(obj.getItem("a.x").toInt32(), 1);
+        EXPECT_TRUE(obj.getItem("missing").isUndefined());
+        EXPECT_TRUE(arr.getItem(5).isUndefined());
+        EXPECT_EQ(item.value().use_count(), 5);
+    }
+    EXPECT_EQ(item.value().use_count(), 3);
+}
+
+TEST(GAnyTest, JsonNumberFidelity)
+{
+    const std::string jsonStr = R"({"big":123456789012345678901234567890,"price":19.99,"tiny":1e-7,"n":-42})";
+    const GAny raw = GAny::parseJson(jsonStr, true);
+    ASSERT_TRUE(raw["price"].is<GAnyNumber>());
+    EXPECT_EQ(raw["price"].toString(), "19.99");
+    EXPECT_DOUBLE_EQ(raw["price"].toDouble(), 19.99);
+    EXPECT_EQ(raw["n"].toInt64(), -42);
+    EXPECT_EQ(raw["n"].toInt32(), -42);
+    EXPECT_EQ(raw["big"].toInt64(), std::numeric_limits<int64_t>::max());
+    EXPECT_TRUE(raw["n"] == GAny(-42));
+    EXPECT_TRUE(raw["price"] < GAny(20));
+
+    // Raw numbers are written back exactly as they were read.
+    const GAny again = GAny::parseJson(raw.toJsonString(), true);
+    EXPECT_EQ(again["big"].toString(), "123456789012345678901234567890");
+    EXPECT_EQ(again["tiny"].toString(), "1e-7");
+
+    // Doubles are dumped with the shortest round-trip representation.
+    EXPECT_EQ(GAny(0.1).toJsonString(), "0.1");
+    EXPECT_EQ(GAny(1.0).toJsonString(), "1");
+    EXPECT_EQ(GAny(0.1f).toJsonString(), "0.1");
+    const double precise = 0.30000000000000004;
+    EXPECT_EQ(GAny::parseJson(GAny(precise).toJsonString()).toDouble(), precise);
+    EXPECT_EQ(GAny::parseJson(GAny(1234567.125).toJsonString()).toDouble(), 1234567.125);
+}
+
 
 TEST(GAnyCastTest, BasicTypes)
 {
@@ -282,3 +406,114 @@ TEST(GAnyCastTest, NumericConversions)
     floatVal = 654.32f;
     EXPECT_NEAR(floatVal.castAs<double>(), 654.32, 0.001);
 }
+
+TEST(GAnyTest, CompiledPath)
+{
+    GAny obj = GAny::parseJson(R"({
+        "a": {"b": [{"c": 1}, {"c": 2}, {"c": 3}]},
+        "key.with.dots": {"x/y": "slash", "m~n": "tilde"},
+        "list": [10, 20, 30]
+    })");
+
+    GAnyPath path("a.b[1].c");
+    EXPECT_TRUE(path.isValid());
+    EXPECT_EQ(path.segments().size(), 4);
+    EXPECT_EQ(obj.getItem(path).toInt32(), 2);
+    EXPECT_EQ(obj.getItem(GAnyPath("$.a.b.2.c")).toInt32(), 3);
+    EXPECT_EQ(obj.getItem(GAnyPath("['key.with.dots']['x/y']")).toString(), "slash");
+    EXPECT_EQ(obj.getItem(GAnyPath("/a/b/0/c")).toInt32(), 1);
+    EXPECT_EQ(obj.getItem(GAnyPath("/key.with.dots/x~1y")).toString(), "slash");
+    EXPECT_EQ(obj.getItem(GAnyPath("/key.with.dots/m~0n")).toString(), "tilde");
+    EXPECT_EQ(obj.getItem(GAnyPath("/list/01")).isUndefined(), true);
+    EXPECT_TRUE(obj.getItem(GAnyPath("a.b[9].c")).isUndefined());
+    EXPECT_TRUE(obj.getItem(GAnyPath("a.missing.c")).isUndefined());
+    EXPECT_FALSE(GAnyPath("a[0").isValid());
+    EXPECT_TRUE(obj.getItem(GAnyPath("a[0")).isUndefined());
+
+    int32_t sum = 0;
+    obj.getItems(GAnyPath("a.b[*].c"), [&sum](const GAny &v) {
+        sum += v.toInt32();
+        return true;
+    });
+    EXPECT_EQ(sum, 6);
+
+    std::vector<int32_t> visited;
+    obj.getItems(GAnyPath("list.*"), [&visited](const GAny &v) {
+        visited.push_back(v.toInt32());
+        return visited.size() < 2;
+    });
+    EXPECT_EQ(visited, std::vector<int32_t>({10, 20}));
+
+    auto pathClass = GAny::Import("GAnyPath");
+    GAny scriptPath = pathClass("list[2]");
+    EXPECT_EQ(scriptPath.call("get", obj).toInt32(), 30);
+}
+
+TEST(GAnyTest, TryGetItemAndTryCall)
+{
+    GAny obj = GAny::parseJson(R"({"a":{"b":[10,20]},"n":null})");
+    auto hit = obj.tryGetItem("a.b");
+    ASSERT_TRUE(hit.has_value());
+    EXPECT_EQ(hit->size(), 2);
+    EXPECT_FALSE(obj.tryGetItem("a.c").has_value());
+    EXPECT_FALSE(obj.tryGetItem("missing.path").has_value());
+    EXPECT_TRUE(obj.tryGetItem("n").has_value());
+    EXPECT_FALSE(hit->tryGetItem(5).has_value());
+    EXPECT_EQ(hit->tryGetItem(1)->toInt32(), 20);
+
+    GAny arr = GAny::array();
+    EXPECT_FALSE(arr.tryCall("noSuchMethod").has_value());
+    auto inserted = arr.tryCall("insert", 0, "x");
+    EXPECT_TRUE(inserted.has_value());
+    EXPECT_EQ(arr.size(), 1);
+
+    // Errors raised by an existing member still surface as exceptions.
+    GAny thrower = [](int32_t) -> int32_t {
+        throw GAnyException("boom");
+    };
+    GAny holder = GAny::object();
+    holder["f"] = thrower;
+    EXPECT_THROW(holder.tryCall("f", 1), GAnyException);
+    EXPECT_FALSE(holder.tryCall("g", 1).has_value());
+}
+
+static int32_t countFrames(const std::string &what)
+{
+    int32_t frames = 0;
+    for (size_t pos = what.find("\n    at "); pos != std::string::npos; pos = what.find("\n    at ", pos + 1)) {
+        frames++;
+    }
+    return frames;
+}
+
+TEST(GAnyTest, CallStackTraceStaysBalanced)
+{
+    GAny inner = [](int32_t) -> int32_t {
+        throw std::runtime_error("inner failure");
+    };
+    GAny outer = [inner](int32_t a) {
+        return inner(a).toInt32();
+    };
+    try {
+        outer(1);
+        FAIL();
+    } catch (GAnyException &e) {
+        EXPECT_EQ(countFrames(e.what()), 2);
+    }
+
+    // A caller that handles the failure and carries on keeps its own frame, later traces include it.
+    GAny recovering = [inner, outer](int32_t a) {
+        try {
+            inner(a);
+        } catch (GAnyException &) {
+        }
+        return outer(a).toInt32();
+    };
+    try {
+        recovering(1);
+        FAIL();
+    } catch (GAnyException &e) {
+        EXPECT_NE(std::string(e.what()).find("inner failure"), std::string::npos);
+        EXPECT_EQ(countFrames(e.what()), 3);
+    }
+}
@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2022 Gxin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <gx/gstring.h>
+
+#include <thread>
+#include <vector>
+
+
+using namespace gx;
+
+namespace
+{
+
+/// Reference: build a string of n characters cycling through 1, 2, 3 and 4-byte UTF-8 sequences.
+const char *kChars[] = {"a", "\xc3\xa9", "\xe4\xb8\xad", "\xf0\x9f\x98\x80"};
+const uint32_t kCodepoints[] = {0x61, 0xe9, 0x4e2d, 0x1f600};
+
+GString makeMixed(int32_t n, std::vector<int32_t> &kinds)
+{
+    std::string s;
+    kinds.clear();
+    for (int32_t i = 0; i < n; i++) {
+        const int32_t k = (i * 7 + i / 3) % 4;
+        kinds.push_back(k);
+        s += kChars[k];
+    }
+    return GString(s);
+}
+
+}
+
+TEST(GStringTest, RandomAccessIndex)
+{
+    std::vector<int32_t> kinds;
+    GString str = makeMixed(1000, kinds);
+    ASSERT_EQ(str.length(), 1000);
+
+    for (int32_t i = 999; i >= 0; i -= 37) {
+        EXPECT_EQ(str.at(i), GString(kChars[kinds[i]])) << i;
+        EXPECT_EQ(str.codepoint(i), kCodepoints[kinds[i]]) << i;
+    }
+    EXPECT_EQ(str.substring(130, 3), GString(std::string(kChars[kinds[130]]) + kChars[kinds[131]] + kChars[kinds[132]]));
+    EXPECT_EQ(str.at(1000), GString());
+
+    // Copies build their own index; edits must invalidate it.
+    GString copy = str;
+    copy.insert(64, "xyz");
+    EXPECT_EQ(copy.length(), 1003);
+    EXPECT_EQ(copy.at(64), GString("x"));
+    EXPECT_EQ(copy.at(67), GString(kChars[kinds[64]]));
+    EXPECT_EQ(copy.codepoint(999), kCodepoints[kinds[996]]);
+    EXPECT_EQ(str.at(64), GString(kChars[kinds[64]]));
+
+    GString ascii(std::string(500, 'q') + "end");
+    EXPECT_EQ(ascii.at(500), GString("e"));
+    EXPECT_EQ(ascii.codepoint(502), (uint32_t) 'd');
+    EXPECT_EQ(ascii.right(3), GString("end"));
+}
+
+TEST(GStringTest, RandomAccessIndexConcurrentReads)
+{
+    std::vector<int32_t> kinds;
+    const GString str = makeMixed(2000, kinds);
+    std::vector<std::thread> threads;
+    std::vector<int32_t> mismatches(4, 0);
+    for (size_t t = 0; t < mismatches.size(); t++) {
+        threads.emplace_back([&, t]() {
+            for (int32_t i = (int32_t) t; i < 2000; i += 13) {
+                mismatches[t] += str.codepoint(i) != kCodepoints[kinds[i]];
+            }
+        });
+    }
+    for (auto &t: threads) {
+        t.join();
+    }
+    for (int32_t m: mismatches) {
+        EXPECT_EQ(m, 0);
+    }
+}
+
+TEST(GStringTest, Utf8LengthValidationAndTranscoding)
+{
+    std::vector<int32_t> kinds;
+    GString str = makeMixed(300, kinds);
+    GString text = GString(std::string(100, 'a')) + str + GString("tail");
+    EXPECT_EQ(text.length(), 404);
+    EXPECT_TRUE(text.isValidUtf8());
+
+    std::u32string u32 = text.toU32String();
+    ASSERT_EQ((int32_t) u32.size(), text.length());
+    for (int32_t i = 0; i < text.length(); i += 13) {
+        EXPECT_EQ((uint32_t) u32[i], text.codepoint(i)) << i;
+    }
+
+    std::u16string u16 = GString("a\xc3\xa9\xe4\xb8\xad\xf0\x9f\x98\x80").toU16String();
+    EXPECT_EQ(u16, std::u16string(u"a\u00e9\u4e2d\U0001F600"));
+
+    // Truncated sequence: counted as one character, like before.
+    GString truncated("ab\xe4\xb8");
+    EXPECT_EQ(truncated.length(), 3);
+    EXPECT_FALSE(truncated.isValidUtf8());
+
+    EXPECT_FALSE(GString("\xc0\xaf").isValidUtf8());          // overlong '/'
+    EXPECT_FALSE(GString("\xed\xa0\x80").isValidUtf8());      // surrogate
+    EXPECT_FALSE(GString("\xf4\x90\x80\x80").isValidUtf8());  // above U+10FFFF
+    EXPECT_FALSE(GString("\x80").isValidUtf8());
+    EXPECT_TRUE(GString("\xf4\x8f\xbf\xbf").isValidUtf8());
+    EXPECT_TRUE(GString().isValidUtf8());
+}
+
+TEST(GStringTest, ReplaceAndSplitViews)
+{
+    std::string big;
+    for (int i = 0; i < 100000; i++) {
+        big += "ab\xe4\xb8\xad,";
+    }
+    GString str(big);
+    GString replaced = str.replace(",", "::");
+    EXPECT_EQ(replaced.count(), str.count() + 100000);
+    EXPECT_EQ(replaced.length(), str.length() + 100000);
+    EXPECT_EQ(replaced.left(7), GString("ab\xe4\xb8\xad::ab"));
+
+    EXPECT_EQ(GString("aaaa").replace("aa", "a"), GString("aa"));
+    EXPECT_EQ(GString("x.y.z").replace(".", "..", 2), GString("x.y..z"));
+
+    GString csv(",a,\xe4\xb8\xad,,b");
+    std::vector<GString> parts = csv.split(",");
+    std::vector<std::string_view> views = csv.splitView(",");
+    ASSERT_EQ(parts.size(), 5u);
+    ASSERT_EQ(views.size(), parts.size());
+    for (size_t i = 0; i < parts.size(); i++) {
+        EXPECT_EQ(std::string(views[i]), parts[i].toStdString());
+    }
+    EXPECT_EQ(std::string(views[2]), "\xe4\xb8\xad");
+
+    // Separators only match on character boundaries: 0xb8 inside a character is skipped.
+    EXPECT_EQ(GString("\xe4\xb8\xad").splitView("\xb8").size(), 1u);
+
+    int tokens = 0;
+    GString("a.b.c").tokenize(".", [&tokens](std::string_view) { tokens++; });
+    EXPECT_EQ(tokens, 3);
+    EXPECT_EQ(GString("abc").splitView("").size(), 1u);
+}
+
+TEST(GStringTest, CaseAndSearchKeepCharacterIndices)
+{
+    GString mixed("Hello \xe4\xb8\xad\xe6\x96\x87 World \xc3\xa9t\xc3\xa9");
+    EXPECT_EQ(mixed.toUpper(), GString("HELLO \xe4\xb8\xad\xe6\x96\x87 WORLD \xc3\xa9T\xc3\xa9"));
+    EXPECT_EQ(mixed.toLower(), GString("hello \xe4\xb8\xad\xe6\x96\x87 world \xc3\xa9t\xc3\xa9"));
+    EXPECT_EQ(mixed.toUpper().length(), mixed.length());
+    EXPECT_EQ(mixed.toUpper().at(9), GString("W"));
+
+    // Brute-force reference over character positions.
+    std::vector<int32_t> kinds;
+    GString str = makeMixed(400, kinds) + GString("needle") + makeMixed(200, kinds);
+    GString needle = str.substring(150, 3);
+    auto refIndexOf = [&](const GString &s, const GString &t, int32_t from) {
+        for (int32_t i = std::max(from, 0); i + t.length() <= s.length(); i++) {
+            if (s.substring(i, t.length()) == t) {
+                return i;
+            }
+        }
+        return -1;
+    };
+    auto refLastIndexOf = [&](const GString &s, const GString &t, int32_t from) {
+        for (int32_t i = std::min(from, s.length() - t.length()); i >= 0; i--) {
+            if (s.substring(i, t.length()) == t) {
+                return i;
+            }
+        }
+        return -1;
+    };
+    for (int32_t from: {0, 1, 63, 64, 150, 151, 400, 500}) {
+        EXPECT_EQ(str.indexOf(needle, from), refIndexOf(str, needle, from)) << from;
+        EXPECT_EQ(str.lastIndexOf(needle, from), refLastIndexOf(str, needle, from)) << from;
+    }
+    EXPECT_EQ(str.indexOf("needle"), 400);
+    EXPECT_EQ(str.lastIndexOf("needle"), 400);
+    EXPECT_EQ(str.lastIndexOf(needle), refLastIndexOf(str, needle, str.length()));
+    EXPECT_EQ(str.indexOf("\xb8"), -1);
+    EXPECT_EQ(str.indexOf("missing"), -1);
+    EXPECT_EQ(GString("abcabc").indexOf("", 2), 2);
+    EXPECT_EQ(GString("abcabc").lastIndexOf("bc", 3), 1);
+}
+
+TEST(GStringTest, UnicodeCaseFold)
+{
+    // "ÉTÉ Ωmega", toLower keeps mapping ASCII only.
+    GString mixed("\xc3\x89T\xc3\x89 \xce\xa9mega");
+    EXPECT_EQ(mixed.toLower(), GString("\xc3\x89t\xc3\x89 \xce\xa9mega"));
+    EXPECT_EQ(mixed.caseFold(), GString("\xc3\xa9t\xc3\xa9 \xcf\x89mega"));
+
+    // Final sigma, Cyrillic, Deseret (4-byte) and an invalid byte.
+    EXPECT_EQ(GString("\xcf\x82\xd0\x9f\xf0\x90\x90\x80\xff").caseFold(),
+              GString("\xcf\x83\xd0\xbf\xf0\x90\x90\xa8\xff"));
+
+    // Kelvin sign folds to 'k' and capital sharp s to U+00DF: same length, fewer bytes.
+    GString shrink("\xe2\x84\xaa\xe1\xba\x9e");
+    EXPECT_EQ(shrink.caseFold(), GString("k\xc3\x9f"));
+    EXPECT_EQ(shrink.caseFold().length(), shrink.length());
+
+    // Characters without a simple folding (dotted capital I only has full/Turkic foldings) are kept.
+    EXPECT_EQ(GString("\xc4\xb0\xc3\x9f\xe4\xb8\xad").caseFold(), GString("\xc4\xb0\xc3\x9f\xe4\xb8\xad"));
+    EXPECT_EQ(GString("ABC xyz").caseFold(), GString("abc xyz"));
+}
@@ -0,0 +1,398 @@
+/*
+ * Copyright (c) 2022 Gxin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <gx/gany_core.h>
+#include <gx/gany.h>
+
+#include <sys/stat.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+
+using namespace gx;
+
+static std::string readFile(const std::string &path)
+{
+    std::ifstream ifs(path);
+    std::stringstream sst;
+    sst << ifs.rdbuf();
+    return sst.str();
+}
+
+/**
+ * Removes the plugin search paths a test added, so later tests see the original list.
+ */
+class PluginSearchPathGuard
+{
+public:
+    PluginSearchPathGuard()
+            : mSaved(getPluginSearchPaths())
+    {
+    }
+
+    ~PluginSearchPathGuard()
+    {
+        const std::vector<std::string> current = getPluginSearchPaths();
+        for (const auto &path: current) {
+            if (std::find(mSaved.begin(), mSaved.end(), path) == mSaved.end()) {
+                removePluginSearchPath(path);
+            }
+        }
+    }
+
+private:
+    std::vector<std::string> mSaved;
+};
+
+static std::string findPluginLibrary(const std::string &libName)
+{
+    std::string libPath;
+    for (const auto &searchPath: getPluginSearchPaths()) {
+        for (const auto &fileName: {"/lib" + libName + ".so", "/" + libName + ".dll", "/lib" + libName + ".dylib"}) {
+            if (std::ifstream(searchPath + fileName).good()) {
+                libPath = searchPath + fileName;
+            }
+        }
+    }
+    return libPath;
+}
+
+static int64_t fileMTime(const std::string &path)
+{
+    struct stat fstat{};
+    return stat(path.c_str(), &fstat) == 0 ? (int64_t) fstat.st_mtime : -1;
+}
+
+TEST(GAnyPluginTest, ManifestDeferredAndConcurrentLoading)
+{
+    PluginSearchPathGuard searchPathGuard;
+    setPluginSearchPath(TEST_PLUGIN_DIR);
+    const std::string pluginName = "test-plugin/TestPlugin";
+    const std::string manifestFile = testing::TempDir() + "gany_plugin_manifest.json";
+
+    const std::string libPath = findPluginLibrary("test-plugin");
+    ASSERT_FALSE(libPath.empty());
+
+    // A manifest from an earlier run already knows the library and the namespace it exports.
+    GAny entry = GAny::object();
+    entry["path"] = libPath;
+    entry["mtime"] = fileMTime(libPath);
+    entry["namespaces"] = std::vector<std::string>{"TestPluginNs"};
+    GAny manifest = GAny::object();
+    manifest["searchPaths"] = getPluginSearchPaths();
+    manifest["plugins"] = GAny::object();
+    manifest["plugins"][pluginName] = entry;
+    std::ofstream(manifestFile, std::ios::trunc) << manifest.toJsonString();
+    setPluginManifest(manifestFile);
+
+    const GAny env = *reinterpret_cast<GAny *>(pfnGanyGetEnv());
+    ASSERT_TRUE(loadPluginDeferred(pluginName));
+    EXPECT_FALSE(env.call("contains", "TestPluginNs").toBool());
+
+    GAny counterClass = GAny::Import("TestPluginNs.Counter");
+    ASSERT_TRUE(counterClass.isClass());
+    EXPECT_TRUE(env.call("contains", "TestPluginNs").toBool());
+    GAny counter = counterClass();
+    EXPECT_EQ(counter.call("next").toInt32(), 1);
+    EXPECT_EQ(counter.call("next").toInt32(), 2);
+
+    GAny saved = GAny::parseJson(readFile(manifestFile));
+    EXPECT_EQ(saved["plugins"][pluginName]["path"].toString(), libPath);
+    EXPECT_EQ(saved["plugins"][pluginName]["namespaces"][0].toString(), "TestPluginNs");
+
+    EXPECT_TRUE(loadPlugins({pluginName, pluginName}, true));
+    EXPECT_FALSE(loadPlugins({pluginName, "missing-plugin/Missing"}, true));
+    EXPECT_TRUE(loadPlugin(pluginName));
+
+    setPluginManifest("");
+    std::remove(manifestFile.c_str());
+}
+
+TEST(GAnyPluginTest, ManifestFilledAndRefreshed)
+{
+    PluginSearchPathGuard searchPathGuard;
+    setPluginSearchPath(TEST_PLUGIN_DIR);
+    const std::string pluginName = "test-plugin-shared-b/TestSharedB";
+    const std::string manifestFile = testing::TempDir() + "gany_plugin_manifest_fill.json";
+    const std::string libPath = findPluginLibrary("test-plugin-shared-b");
+    ASSERT_FALSE(libPath.empty());
+    std::remove(manifestFile.c_str());
+
+    // First run: the library is found by walking the search paths, and its namespaces are recorded.
+    setPluginManifest(manifestFile);
+    ASSERT_TRUE(loadPlugin(pluginName));
+    GAny saved = GAny::parseJson(readFile(manifestFile));
+    EXPECT_EQ(saved["searchPaths"].toJsonString(), GAny(getPluginSearchPaths()).toJsonString());
+    EXPECT_EQ(saved["plugins"][pluginName]["path"].toString(), libPath);
+    EXPECT_EQ(saved["plugins"][pluginName]["mtime"].toInt64(), fileMTime(libPath));
+    ASSERT_EQ(saved["plugins"][pluginName]["namespaces"].size(), 1u);
+    EXPECT_EQ(saved["plugins"][pluginName]["namespaces"][0].toString(), "TestSharedNs");
+
+    // An entry whose mtime no longer matches the library is dropped and refreshed.
+    saved["plugins"][pluginName]["mtime"] = (int64_t) 1;
+    std::ofstream(manifestFile, std::ios::trunc) << saved.toJsonString();
+    setPluginManifest(manifestFile);
+    ASSERT_TRUE(loadPlugin(pluginName));
+    saved = GAny::parseJson(readFile(manifestFile));
+    EXPECT_EQ(saved["plugins"][pluginName]["mtime"].toInt64(), fileMTime(libPath));
+    EXPECT_EQ(saved["plugins"][pluginName]["path"].toString(), libPath);
+
+    // Changing the search paths invalidates every entry, also ones that are never looked up again.
+    GAny ghost = GAny::object();
+    ghost["path"] = libPath;
+    ghost["mtime"] = fileMTime(libPath);
+    saved["plugins"]["ghost-plugin/Ghost"] = ghost;
+    std::ofstream(manifestFile, std::ios::trunc) << saved.toJsonString();
+    setPluginManifest(manifestFile);
+    const std::string extraPath = testing::TempDir() + "gany_plugin_extra_path";
+    std::filesystem::create_directories(extraPath);
+    setPluginSearchPath(extraPath);
+    ASSERT_TRUE(loadPlugin(pluginName));
+    saved = GAny::parseJson(readFile(manifestFile));
+    EXPECT_EQ(saved["searchPaths"].toJsonString(), GAny(getPluginSearchPaths()).toJsonString());
+    EXPECT_FALSE(saved["plugins"].contains("ghost-plugin/Ghost"));
+    EXPECT_EQ(saved["plugins"][pluginName]["path"].toString(), libPath);
+
+    // So does a manifest written for other search paths.
+    saved["searchPaths"] = std::vector<std::string>{"/elsewhere"};
+    saved["plugins"]["ghost-plugin/Ghost"] = ghost;
+    std::ofstream(manifestFile, std::ios::trunc) << saved.toJsonString();
+    setPluginManifest(manifestFile);
+    ASSERT_TRUE(loadPlugin(pluginName));
+    saved = GAny::parseJson(readFile(manifestFile));
+    EXPECT_EQ(saved["searchPaths"].toJsonString(), GAny(getPluginSearchPaths()).toJsonString());
+    EXPECT_FALSE(saved["plugins"].contains("ghost-plugin/Ghost"));
+
+    setPluginManifest("");
+    std::remove(manifestFile.c_str());
+    std::filesystem::remove(extraPath);
+}
+
+TEST(GAnyPluginTest, DeferredPluginSharingLoadedNamespace)
+{
+    PluginSearchPathGuard searchPathGuard;
+    setPluginSearchPath(TEST_PLUGIN_DIR);
+    const std::string pluginName = "test-plugin-shared-a/TestSharedA";
+    const std::string manifestFile = testing::TempDir() + "gany_plugin_manifest_shared.json";
+    const std::string libPath = findPluginLibrary("test-plugin-shared-a");
+    ASSERT_FALSE(libPath.empty());
+
+    // Another plugin already provides the namespace eagerly.
+    ASSERT_TRUE(loadPlugin("test-plugin-shared-b/TestSharedB"));
+    ASSERT_TRUE(GAny::Import("TestSharedNs.B").isClass());
+
+    GAny entry = GAny::object();
+    entry["path"] = libPath;
+    entry["mtime"] = fileMTime(libPath);
+    entry["namespaces"] = std::vector<std::string>{"TestSharedNs"};
+    GAny manifest = GAny::object();
+    manifest["searchPaths"] = getPluginSearchPaths();
+    manifest["plugins"] = GAny::object();
+    manifest["plugins"][pluginName] = entry;
+    std::ofstream(manifestFile, std::ios::trunc) << manifest.toJsonString();
+    setPluginManifest(manifestFile);
+
+    // The namespace cannot be made lazy, so the plugin is loaded right away.
+    ASSERT_TRUE(loadPluginDeferred(pluginName));
+    EXPECT_TRUE(GAny::Import("TestSharedNs.A").isClass());
+    EXPECT_TRUE(GAny::Import("TestSharedNs.B").isClass());
+
+    setPluginManifest("");
+    std::remove(manifestFile.c_str());
+}
+
+TEST(GAnyPluginTest, FailedRegistrationIsNotRetried)
+{
+    PluginSearchPathGuard searchPathGuard;
+    setPluginSearchPath(TEST_PLUGIN_DIR);
+    EXPECT_FALSE(loadPlugins({"test-plugin-failing/TestFailing"}, false));
+
+    GAny probe = GAny::Import("TestFailingNs.Probe");
+    ASSERT_TRUE(probe.isClass());
+    EXPECT_EQ(probe.call("registerCalls").toInt32(), 1);
+
+    // Resolved through the manifest, a failing module is not registered again by the search path walk.
+    const std::string pluginName = "test-plugin-failing/TestFailing";
+    const std::string manifestFile = testing::TempDir() + "gany_plugin_manifest_failing.json";
+    const std::string libPath = findPluginLibrary("test-plugin-failing");
+    ASSERT_FALSE(libPath.empty());
+    GAny entry = GAny::object();
+    entry["path"] = libPath;
+    entry["mtime"] = fileMTime(libPath);
+    entry["namespaces"] = std::vector<std::string>{"TestFailingNs"};
+    GAny manifest = GAny::object();
+    manifest["searchPaths"] = getPluginSearchPaths();
+    manifest["plugins"] = GAny::object();
+    manifest["plugins"][pluginName] = entry;
+    std::ofstream(manifestFile, std::ios::trunc) << manifest.toJsonString();
+    setPluginManifest(manifestFile);
+
+    EXPECT_FALSE(loadPlugin(pluginName));
+    EXPECT_EQ(probe.call("registerCalls").toInt32(), 2);
+
+    setPluginManifest("");
+    std::remove(manifestFile.c_str());
+}
+
+class LazyTestValue
+{
+};
+
+TEST(GAnyPluginTest, LazyEnvEntriesLoadExactlyOnce)
+{
+    static std::atomic<int32_t> sLoads(0);
+    GAny::ExportLazy("LazyTestNs", [] {
+        sLoads++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        Class<LazyTestValue>("LazyTestNs", "Value", "");
+    });
+    const GAny env = *reinterpret_cast<GAny *>(pfnGanyGetEnv());
+    EXPECT_TRUE(env.call("isLazy", "LazyTestNs").toBool());
+    EXPECT_EQ(sLoads, 0);
+
+    std::vector<std::thread> threads;
+    std::atomic<int32_t> resolved(0);
+    for (int32_t i = 0; i < 8; i++) {
+        threads.emplace_back([&resolved]() {
+            if (GAny::Import("LazyTestNs.Value").isClass()) {
+                resolved++;
+            }
+        });
+    }
+    for (auto &t: threads) {
+        t.join();
+    }
+    EXPECT_EQ(sLoads, 1);
+    EXPECT_EQ(resolved, 8);
+    EXPECT_FALSE(env.call("isLazy", "LazyTestNs").toBool());
+    EXPECT_TRUE(GAny::Import("LazyTestNs.Value").isClass());
+    EXPECT_EQ(sLoads, 1);
+}
+
+class LazyThrowValue
+{
+};
+
+TEST(GAnyPluginTest, LazyEnvLoaderFailureIsContained)
+{
+    GAny::ExportLazy("LazyThrowNs", [] {
+        throw std::runtime_error("lazy loader failure");
+    });
+    GAny value;
+    EXPECT_NO_THROW(value = GAny::Import("LazyThrowNs.Value"));
+    EXPECT_TRUE(value.isUndefined());
+
+    // The failed loader does not leave this thread marked as loading, later registrations resolve normally.
+    const GAny env = *reinterpret_cast<GAny *>(pfnGanyGetEnv());
+    EXPECT_FALSE(env.call("isLazy", "LazyThrowNs").toBool());
+    Class<LazyThrowValue>("LazyThrowNs", "Value", "");
+    EXPECT_TRUE(GAny::Import("LazyThrowNs.Value").isClass());
+
+    // An exception that escapes the loader leaves the entry lazy, the next lookup on this thread retries it.
+    static int32_t sAttempts = 0;
+    GAny::ExportLazy("LazyRetryNs", [] {
+        if (sAttempts++ == 0) {
+            throw 1;
+        }
+        Class<LazyThrowValue>("LazyRetryNs", "Value", "");
+    });
+    EXPECT_ANY_THROW(GAny::Import("LazyRetryNs.Value"));
+    EXPECT_TRUE(GAny::Import("LazyRetryNs.Value").isClass());
+    EXPECT_EQ(sAttempts, 2);
+}
+
+template<int32_t N>
+class ConcurrentNsValue
+{
+};
+
+template<int32_t... N>
+static void registerConcurrently(std::integer_sequence<int32_t, N...>)
+{
+    std::vector<std::thread> threads;
+    (threads.emplace_back([]() {
+        Class<ConcurrentNsValue<N>>("ConcurrentRegisterNs", "Value" + std::to_string(N), "");
+    }), ...);
+    for (auto &t: threads) {
+        t.join();
+    }
+}
+
+TEST(GAnyPluginTest, ConcurrentRegistrationIntoOneNamespace)
+{
+    registerConcurrently(std::make_integer_sequence<int32_t, 16>());
+    for (int32_t i = 0; i < 16; i++) {
+        EXPECT_TRUE(GAny::Import("ConcurrentRegisterNs.Value" + std::to_string(i)).isClass()) << i;
+    }
+}
+
+class ImportCacheA
+{
+};
+
+class ImportCacheB
+{
+};
+
+TEST(GAnyPluginTest, ImportCacheFollowsEnvChanges)
+{
+    const GAny &env = *reinterpret_cast<GAny *>(pfnGanyGetEnv());
+    const auto *envObject = static_cast<const GAnyValue *>(env.value()->ptr());
+    const auto *version = reinterpret_cast<const GAnyEnvVersion *>(envObject->as(typeid(GAnyEnvVersion)));
+    ASSERT_NE(version, nullptr);
+
+    EXPECT_TRUE(GAny::Import("ImportCacheNs.A").isUndefined());
+    uint64_t before = version->value;
+    Class<ImportCacheA>("ImportCacheNs", "A", "");
+    EXPECT_GT(version->value.load(), before);
+
+    GAny a = GAny::Import("ImportCacheNs.A");
+    ASSERT_TRUE(a.isClass());
+    EXPECT_EQ(GAny::Import("ImportCacheNs.A").value(), a.value());
+
+    // A registration elsewhere invalidates the cache, lookups still resolve to the same classes.
+    Class<ImportCacheB>("ImportCacheNs", "B", "");
+    EXPECT_EQ(GAny::Import("ImportCacheNs.A").value(), a.value());
+    EXPECT_TRUE(GAny::Import("ImportCacheNs.B").isClass());
+
+    std::vector<std::thread> threads;
+    std::atomic<int32_t> resolved(0);
+    for (int32_t i = 0; i < 4; i++) {
+        threads.emplace_back([&resolved, &a]() {
+            for (int32_t j = 0; j < 1000; j++) {
+                if (GAny::Import("ImportCacheNs.A").value() == a.value()) {
+                    resolved++;
+                }
+            }
+        });
+    }
+    for (auto &t: threads) {
+        t.join();
+    }
+    EXPECT_EQ(resolved, 4000);
+}
@@ -25,6 +25,8 @@
 #include <gx/gany_core.h>
 #include <gx/gany.h>
 
+#include <thread>
+
 
 using namespace gx;
 
@@ -156,4 +158,72 @@ TEST(GAnyReflectionTest, DirectTypeCreationWithGAnyClass)
     EXPECT_EQ(tDynamicType.getItem("DynamicEnum.VAL_1").toInt32(), 1);
     EXPECT_EQ(tDynamicType.getItem("DynamicEnum.VAL_2").toInt32(), 2);
     EXPECT_EQ(tDynamicType.getItem("DynamicEnum.VAL_3").toInt32(), 3);
-}
\ No newline at end of file
+}
+
+class LookupBase
+{
+};
+
+class LookupDerived : public LookupBase
+{
+};
+
+TEST(GAnyReflectionTest, MissingMemberErrors)
+{
+    Class<LookupBase>("MyNamespace", "LookupBase", "")
+            .func("ping", [](LookupBase &) {
+                return 1;
+            });
+    Class<LookupDerived>("MyNamespace", "LookupDerived", "")
+            .inherit<LookupBase>()
+            .construct<>();
+
+    GAny obj = GAnyClass::instance<LookupDerived>()->_new();
+    EXPECT_EQ(obj.call("ping").toInt32(), 1);
+    EXPECT_TRUE(obj.getItem("ping").isCaller());
+
+    // Misses are resolved without unwinding, but the public API still reports them with the same text.
+    try {
+        obj.getItem("missing");
+        FAIL();
+    } catch (GAnyException &e) {
+        EXPECT_STREQ(e.what(), "Class LookupDerived don't know how to do getItem missing. \n"
+                               "Class LookupBase don't know how to do getItem missing. \n");
+    }
+    try {
+        obj.call("missing");
+        FAIL();
+    } catch (GAnyException &e) {
+        EXPECT_STREQ(e.what(), "Class LookupBase failed to call method missing.");
+    }
+    EXPECT_FALSE(obj.tryGetItem("missing").has_value());
+    EXPECT_TRUE(GAny::object().getItem("missing").isUndefined());
+    EXPECT_TRUE(GAny::array().getItem("missing").isUndefined());
+}
+
+class ConcurrentInstanceType
+{
+};
+
+TEST(GAnyReflectionTest, ClassInstanceIsStablePerType)
+{
+    std::vector<std::thread> threads;
+    std::vector<GAnyClass *> classes(8, nullptr);
+    for (size_t i = 0; i < classes.size(); i++) {
+        threads.emplace_back([&classes, i]() {
+            classes[i] = GAnyClass::instance<ConcurrentInstanceType>().get();
+        });
+    }
+    for (auto &t: threads) {
+        t.join();
+    }
+    ASSERT_NE(classes[0], nullptr);
+    for (auto *cls: classes) {
+        EXPECT_EQ(cls, classes[0]);
+    }
+
+    GAny value = std::make_shared<ConcurrentInstanceType>();
+    EXPECT_EQ(&value.classObject(), classes[0]);
+    EXPECT_EQ(GAnyClass::instance<std::shared_ptr<ConcurrentInstanceType>>().get(), classes[0]);
+    EXPECT_EQ(GAnyClass::instance<int32_t>().get(), &GAny(1).classObject());
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2022 Gxin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <gx/gany_core.h>
+#include <gx/gany_schema.h>
+
+#include <chrono>
+
+
+using namespace gx;
+
+static const char *kRecordSchema = R"({
+    "type": "object",
+    "required": ["id", "name", "tags"],
+    "properties": {
+        "id": {"type": "integer", "minimum": 0},
+        "name": {"type": "string", "minLength": 1},
+        "score": {"type": "number", "maximum": 100},
+        "tags": {"type": "array", "items": {"type": "string"}}
+    },
+    "additionalProperties": false
+})";
+
+static GAny makeRecord(int64_t id)
+{
+    GAny record = GAny::object();
+    record["id"] = id;
+    record["name"] = "record_" + std::to_string(id);
+    record["score"] = 42.5;
+    record["tags"] = GAny::array();
+    record["tags"].pushBack("a");
+    record["tags"].pushBack("b");
+    return record;
+}
+
+TEST(GAnySchemaTest, ValidateTree)
+{
+    std::string error;
+    GAnySchema schema = GAnySchema::parse(kRecordSchema, &error);
+    ASSERT_TRUE(schema.isValid()) << error;
+
+    EXPECT_TRUE(schema.validate(makeRecord(1), &error)) << error;
+
+    GAny missing = makeRecord(2);
+    missing.erase("name");
+    EXPECT_FALSE(schema.validate(missing, &error));
+    EXPECT_NE(error.find("required"), std::string::npos);
+
+    GAny wrongItem = makeRecord(3);
+    wrongItem["tags"].pushBack(7);
+    EXPECT_FALSE(schema.validate(wrongItem, &error));
+    EXPECT_NE(error.find("/tags/2"), std::string::npos);
+
+    GAny extra = makeRecord(4);
+    extra["unknown"] = true;
+    EXPECT_FALSE(schema.validate(extra));
+
+    GAny unsignedId = makeRecord(5);
+    unsignedId["id"] = (uint32_t) 5;
+    EXPECT_TRUE(schema.validate(unsignedId));
+
+    GAny negative = makeRecord(6);
+    negative["id"] = -1;
+    EXPECT_FALSE(schema.validate(negative));
+}
+
+TEST(GAnySchemaTest, CompileFromGAny)
+{
+    GAnySchema schema = GAnySchema::compile(GAny::parseJson(kRecordSchema));
+    ASSERT_TRUE(schema.isValid());
+    EXPECT_TRUE(schema.validate(makeRecord(1)));
+
+    EXPECT_FALSE(GAnySchema::parse("[1, 2]").isValid());
+    std::string error;
+    EXPECT_FALSE(GAnySchema::parse("{", &error).isValid());
+    EXPECT_FALSE(error.empty());
+    EXPECT_FALSE(GAnySchema().validate(makeRecord(1)));
+}
+
+TEST(GAnySchemaTest, ValidateAndParseJson)
+{
+    GAnySchema schema = GAnySchema::parse(kRecordSchema);
+    const std::string good = R"({"id": 1, "name": "x", "tags": ["t"], "score": 1.5})";
+    const std::string bad = R"({"id": 1, "name": "", "tags": []})";
+
+    std::string error;
+    EXPECT_TRUE(schema.validateJson(good, &error)) << error;
+    EXPECT_FALSE(schema.validateJson(bad, &error));
+    EXPECT_NE(error.find("minLength"), std::string::npos);
+    EXPECT_FALSE(schema.validateJson("{\"id\": 1,", &error));
+
+    GAny v = schema.parseJson(good, &error);
+    ASSERT_TRUE(v.isObject()) << error;
+    EXPECT_EQ(v["name"].toString(), "x");
+    EXPECT_EQ(v["tags"][0].toString(), "t");
+    EXPECT_DOUBLE_EQ(v["score"].toDouble(), 1.5);
+    EXPECT_TRUE(schema.parseJson(bad).isUndefined());
+}
+
+TEST(GAnySchemaTest, Reflection)
+{
+    auto tGAnySchema = GAny::Import("GAnySchema");
+    GAny schema = tGAnySchema.call("compile", std::string(kRecordSchema));
+    ASSERT_FALSE(schema.isNull());
+    EXPECT_TRUE(schema.call("validate", makeRecord(1)).toBool());
+    EXPECT_TRUE(schema.call("check", makeRecord(1)).isNull());
+    EXPECT_TRUE(schema.call("check", GAny::object()).isString());
+    EXPECT_TRUE(tGAnySchema.call("compile", std::string("{")).isNull());
+}
+
+TEST(GAnySchemaTest, DISABLED_ValidateThroughput)
+{
+    GAnySchema schema = GAnySchema::parse(kRecordSchema);
+    std::vector<GAny> records;
+    records.reserve(100000);
+    for (int64_t i = 0; i < 100000; i++) {
+        records.push_back(makeRecord(i));
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    size_t valid = 0;
+    for (const auto &r: records) {
+        valid += schema.validate(r) ? 1 : 0;
+    }
+    auto compiled = std::chrono::steady_clock::now();
+    for (const auto &r: records) {
+        valid += schema.validateJson(r.toJsonString()) ? 1 : 0;
+    }
+    auto serialized = std::chrono::steady_clock::now();
+
+    EXPECT_EQ(valid, records.size() * 2);
+    std::cout << "validate: "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(compiled - begin).count() << "ms, "
+              << "serialize + validateJson: "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(serialized - compiled).count() << "ms"
+              << std::endl;
+}